@@ -47,7 +47,7 @@ public:
 };
 
 void main_nonshuffle(int argc, char **argv) {
-	Engine e(std::string(argv[1]), atoi(argv[2]), 1);
+	Engine e(std::string(argv[1]), atoi(argv[2]), 1, Engine::parse_partition_type(argc > 4 ? argv[4] : nullptr), Engine::parse_vertex_order(argc > 5 ? argv[5] : nullptr));
 	std::cout << Logger::generate_log_del(std::string("finish preprocessing"), 1) << std::endl;
 
 	ResourceManager rm;
@@ -55,29 +55,21 @@ void main_nonshuffle(int argc, char **argv) {
 	auto start_clique = std::chrono::high_resolution_clock::now();
 
 	MC mPhase(e, atoi(argv[3]));
-	Aggregation agg(e, false);
 
 	//init: get the edges stream
 	std::cout << "\n\n" << Logger::generate_log_del(std::string("init"), 1) << std::endl;
 	Update_Stream up_stream = mPhase.init_clique();
 	mPhase.printout_upstream(up_stream);
 
-	Update_Stream up_stream_new;
 	Update_Stream clique_stream;
 
 	for(unsigned int i = 0; i < mPhase.get_max_size() - 2; ++i){
 		std::cout << "\n\n" << Logger::generate_log_del(std::string("Iteration ") + std::to_string(i), 1) << std::endl;
 
-		//join on all keys
+		//join on all keys, extending each clique by the common neighbors of its members only
 		std::cout << "\n" << Logger::generate_log_del(std::string("joining"), 2) << std::endl;
-		up_stream_new = mPhase.join_all_keys_nonshuffle_clique(up_stream);
+		clique_stream = mPhase.join_all_keys_nonshuffle_clique_intersect(up_stream);
 		mPhase.delete_upstream(up_stream);
-		mPhase.printout_upstream(up_stream_new);
-
-		//collect cliques
-		std::cout << "\n" << Logger::generate_log_del(std::string("collecting"), 2) << std::endl;
-		clique_stream = agg.aggregate_filter_clique(up_stream_new, mPhase.get_sizeof_in_tuple());
-		mPhase.delete_upstream(up_stream_new);
 		mPhase.printout_upstream(clique_stream);
 
 //		//print out cliques
@@ -108,8 +100,8 @@ void main_nonshuffle(int argc, char **argv) {
 }
 
 int main(int argc, char **argv){
-	if(argc != 4) {
-		fprintf(stderr, "usage: bin/clique_find [input graph(adj list format)] [num of partitions] [size of clique]\n");
+	if(argc < 4 || argc > 6) {
+		fprintf(stderr, "usage: bin/clique_find [input graph(adj list format)] [num of partitions] [size of clique] [partitioning: vertices (default) or edges] [vertex order: original (default) or degree]\n");
 		exit(-1);
 	}
 	main_nonshuffle(argc, argv);
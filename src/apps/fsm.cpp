@@ -44,7 +44,7 @@ public:
 
 
 void main_nonshuffle(int argc, char **argv) {
-	Engine e(std::string(argv[1]), atoi(argv[2]), 1);
+	Engine e(std::string(argv[1]), atoi(argv[2]), 1, Engine::parse_partition_type(argc > 5 ? argv[5] : nullptr), Engine::parse_vertex_order(argc > 6 ? argv[6] : nullptr));
 	std::cout << Logger::generate_log_del(std::string("finish preprocessing"), 1) << std::endl;
 
 	ResourceManager rm;
@@ -65,6 +65,7 @@ void main_nonshuffle(int argc, char **argv) {
 	std::cout << "\n" << Logger::generate_log_del(std::string("aggregating"), 2) << std::endl;
 	Aggregation_Stream agg_stream = agg.aggregate(up_stream, mPhase.get_sizeof_in_tuple());
 	agg.printout_aggstream(agg_stream, mPhase.get_sizeof_in_tuple());
+	agg.printout_canonical_cache();
 
 	//filter infrequent edges
 	std::cout << "\n" << Logger::generate_log_del(std::string("filtering"), 2) << std::endl;
@@ -89,6 +90,7 @@ void main_nonshuffle(int argc, char **argv) {
 		std::cout << "\n" << Logger::generate_log_del(std::string("aggregating"), 2) << std::endl;
 		agg_stream = agg.aggregate(up_stream, mPhase.get_sizeof_in_tuple());
 		agg.printout_aggstream(agg_stream, mPhase.get_sizeof_in_tuple());
+		agg.printout_canonical_cache();
 
 //		//print out frequent patterns
 //		std::cout << "\n" << Logger::generate_log_del(std::string("printing"), 2) << std::endl;
@@ -123,7 +125,7 @@ void main_nonshuffle(int argc, char **argv) {
 }
 
 void main_shuffle(int argc, char **argv) {
-	Engine e(std::string(argv[1]), atoi(argv[2]), 1);
+	Engine e(std::string(argv[1]), atoi(argv[2]), 1, Engine::parse_partition_type(argc > 5 ? argv[5] : nullptr), Engine::parse_vertex_order(argc > 6 ? argv[6] : nullptr));
 	std::cout << "\n\n" << Logger::generate_log_del(std::string("finish preprocessing"), 1) << std::endl;
 
 	ResourceManager rm;
@@ -144,6 +146,7 @@ void main_shuffle(int argc, char **argv) {
 	//print out frequent patterns
 	std::cout << "\n" << Logger::generate_log_del(std::string("printing"), 2) << std::endl;
 	agg.printout_aggstream(agg_stream, mPhase.get_sizeof_in_tuple());
+	agg.printout_canonical_cache();
 	//filter infrequent edges
 	std::cout << "\n" << Logger::generate_log_del(std::string("filtering"), 2) << std::endl;
 	Update_Stream up_stream_non_shuffled_filtered = agg.aggregate_filter(up_stream_non_shuffled, agg_stream, mPhase.get_sizeof_in_tuple(), threshold);
@@ -170,6 +173,7 @@ void main_shuffle(int argc, char **argv) {
 		//print out frequent patterns
 		std::cout << "\n" << Logger::generate_log_del(std::string("printing"), 2) << std::endl;
 		agg.printout_aggstream(agg_stream, mPhase.get_sizeof_in_tuple());
+		agg.printout_canonical_cache();
 		//filter infrequent subgraphs
 		std::cout << "\n" << Logger::generate_log_del(std::string("filtering"), 2) << std::endl;
 		up_stream_non_shuffled_filtered = agg.aggregate_filter(up_stream_non_shuffled, agg_stream, mPhase.get_sizeof_in_tuple(), threshold);
@@ -203,8 +207,8 @@ void main_shuffle(int argc, char **argv) {
 }
 
 int main(int argc, char **argv){
-	if(argc != 5) {
-		fprintf(stderr, "usage: bin/fsm [input graph(adj list format)] [num of partitions] [pattern size] [support] \n");
+	if(argc < 5 || argc > 7) {
+		fprintf(stderr, "usage: bin/fsm [input graph(adj list format)] [num of partitions] [pattern size] [support] [partitioning: vertices (default) or edges] [vertex order: original (default) or degree] \n");
 		exit(-1);
 	}
 //	main_shuffle(argc, argv);
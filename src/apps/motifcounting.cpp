@@ -44,7 +44,7 @@ public:
 
 
 void main_nonshuffle(int argc, char **argv) {
-	Engine e(std::string(argv[1]), atoi(argv[2]), 1);
+	Engine e(std::string(argv[1]), atoi(argv[2]), 1, Engine::parse_partition_type(argc > 4 ? argv[4] : nullptr), Engine::parse_vertex_order(argc > 5 ? argv[5] : nullptr));
 	std::cout << Logger::generate_log_del(std::string("finish preprocessing"), 1) << std::endl;
 
 	ResourceManager rm;
@@ -78,6 +78,7 @@ void main_nonshuffle(int argc, char **argv) {
 		std::cout << "\n" << Logger::generate_log_del(std::string("aggregating"), 2) << std::endl;
 		agg_stream = agg.aggregate(up_stream_new, mPhase.get_sizeof_in_tuple());
 		agg.printout_aggstream(agg_stream, mPhase.get_sizeof_in_tuple());
+		agg.printout_canonical_cache();
 
 //		//print out counts info
 //		std::cout << "\n" << Logger::generate_log_del(std::string("printing"), 2) << std::endl;
@@ -107,7 +108,7 @@ void main_nonshuffle(int argc, char **argv) {
 }
 
 void main_shuffle(int argc, char **argv) {
-	Engine e(std::string(argv[1]), atoi(argv[2]), 1);
+	Engine e(std::string(argv[1]), atoi(argv[2]), 1, Engine::parse_partition_type(argc > 4 ? argv[4] : nullptr), Engine::parse_vertex_order(argc > 5 ? argv[5] : nullptr));
 	std::cout << Logger::generate_log_del(std::string("finish preprocessing"), 1) << std::endl;
 
 	ResourceManager rm;
@@ -138,6 +139,7 @@ void main_shuffle(int argc, char **argv) {
 		//print out counts info
 		std::cout << "\n" << Logger::generate_log_del(std::string("printing"), 2) << std::endl;
 		agg.printout_aggstream(agg_stream, mPhase.get_sizeof_in_tuple());
+		agg.printout_canonical_cache();
 		agg.delete_aggstream(agg_stream);
 		//shuffle for next join
 		std::cout << "\n" << Logger::generate_log_del(std::string("shuffling"), 2) << std::endl;
@@ -163,8 +165,8 @@ void main_shuffle(int argc, char **argv) {
 
 
 int main(int argc, char **argv){
-	if(argc != 4) {
-		fprintf(stderr, "bin/motif_count [input graph(adj list format)] [num of partitions] [size of motif]\n");
+	if(argc < 4 || argc > 6) {
+		fprintf(stderr, "bin/motif_count [input graph(adj list format)] [num of partitions] [size of motif] [partitioning: vertices (default) or edges] [vertex order: original (default) or degree]\n");
 		exit(-1);
 	}
 //	main_shuffle(argc, argv);
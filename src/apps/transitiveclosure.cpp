@@ -51,19 +51,20 @@ namespace std {
 	};
 }
 
-Out_Update_TC * generate_one_update(Edge * e) {
-	Out_Update_TC * out_update = new Out_Update_TC(e->src, e->target);
-	return out_update;
+void generate_one_update(Edge * e, Out_Update_TC & out_update) {
+	out_update.src = e->src;
+	out_update.target = e->target;
 }
 
-Out_Update_TC * generate_out_update(In_Update_TC * in_update) {
-	Out_Update_TC * out_update = new Out_Update_TC(in_update->src, in_update->target);
-	return out_update;
+void generate_out_update(In_Update_TC * in_update, Out_Update_TC & out_update) {
+	out_update.src = in_update->src;
+	out_update.target = in_update->target;
 }
 
 class TC : public RPhase<In_Update_TC, Out_Update_TC> {
 	public:
 		TC(Engine & e) : RPhase(e) {};
+		TC(Engine & e, const edge_index * edges) : RPhase(e, edges) {};
 		~TC(){};
 
 //		bool filter(In_Update_TC * update, Edge * edge) {
@@ -77,10 +78,10 @@ class TC : public RPhase<In_Update_TC, Out_Update_TC> {
 		}
 
 //		Out_Update_TC * project_columns(In_Update_TC * in_update, Edge * edge) {
-		Out_Update_TC * project_columns(In_Update_TC * in_update, VertexId edge_src, VertexId edge_target) {
+		void project_columns(In_Update_TC * in_update, VertexId edge_src, VertexId edge_target, Out_Update_TC & new_update) {
 //			Out_Update_TC * new_update = new Out_Update_TC(in_update->src, edge->target);
-			Out_Update_TC * new_update = new Out_Update_TC(in_update->src, edge_target);
-			return new_update;
+			new_update.src = in_update->src;
+			new_update.target = edge_target;
 		}
 };
 
@@ -130,12 +131,12 @@ void printUpdateStream(int num_partitions, std::string fileName, Update_Stream i
 }
 
 int main(int argc, char ** argv) {
-	if(argc != 3) {
-		fprintf(stderr, "usage: bin/trans_closure [input graph(edge list format) [num of partitions]]\n");
+	if(argc < 3 || argc > 5) {
+		fprintf(stderr, "usage: bin/trans_closure [input graph(edge list format) [num of partitions] [partitioning: vertices (default) or edges] [vertex order: original (default) or degree]]\n");
 		exit(-1);
 	}
 
-	Engine e(std::string(argv[1]), atoi(argv[2]), 0);
+	Engine e(std::string(argv[1]), atoi(argv[2]), 0, Engine::parse_partition_type(argc > 3 ? argv[3] : nullptr), Engine::parse_vertex_order(argc > 4 ? argv[4] : nullptr));
 	std::cout << Logger::generate_log_del(std::string("finish preprocessing"), 1) << std::endl;
 
 	auto start = std::chrono::high_resolution_clock::now();
@@ -152,7 +153,8 @@ int main(int argc, char ** argv) {
 //	printUpdateStream<In_Update_TC>(e.num_partitions, e.filename, tc);
 
 	Scatter_Updates<In_Update_TC, Out_Update_TC> sc_up(e);
-	TC triangle_counting(e);
+	// the edges are the same in every iteration, index them once and share the index across all joins
+	TC triangle_counting(e, &e.get_edge_index());
 
 	while(!should_terminate(delta_tc, e)) {
 
@@ -3,6 +3,7 @@
 #include "../core/scatter.hpp"
 #include "../core/relation_phase.hpp"
 #include "../core/global_info.hpp"
+#include "../core/triangle_counting.hpp"
 //#include "BaseApplication.hpp"
 
 using namespace RStream;
@@ -48,10 +49,10 @@ inline std::ostream & operator<<(std::ostream & strm, const ROutUpdate_TriC& upd
 }
 
 
-RInUpdate_TriC* generate_one_update(Edge * e)
+void generate_one_update(Edge * e, RInUpdate_TriC & update)
 {
-	RInUpdate_TriC* update = new RInUpdate_TriC(e->target, e->src);
-	return update;
+	update.target = e->target;
+	update.src = e->src;
 }
 
 
@@ -73,10 +74,11 @@ public:
 	}
 
 //	ROutUpdate_TriC * project_columns(RInUpdate_TriC * in_update, Edge * edge) {
-	ROutUpdate_TriC * project_columns(RInUpdate_TriC * in_update, VertexId edge_src, VertexId edge_dst) {
+	void project_columns(RInUpdate_TriC * in_update, VertexId edge_src, VertexId edge_dst, ROutUpdate_TriC & new_update) {
 //		ROutUpdate_TriC * new_update = new ROutUpdate_TriC(edge->target, in_update->src, in_update->target);
-		ROutUpdate_TriC * new_update = new ROutUpdate_TriC(edge_dst, in_update->src, in_update->target);
-		return new_update;
+		new_update.target = edge_dst;
+		new_update.src1 = in_update->src;
+		new_update.src2 = in_update->target;
 	}
 };
 
@@ -93,10 +95,9 @@ public:
 	}
 
 //	ROutUpdate_TriC * project_columns(ROutUpdate_TriC * in_update, Edge * edge) {
-	ROutUpdate_TriC * project_columns(ROutUpdate_TriC * in_update, VertexId edge_src, VertexId edge_dst) {
+	void project_columns(ROutUpdate_TriC * in_update, VertexId edge_src, VertexId edge_dst, ROutUpdate_TriC & new_update) {
 //		ROutUpdate_TriC * new_update = new ROutUpdate_TriC(in_update->target, in_update->src1, in_update->src2);
-		ROutUpdate_TriC * new_update = new ROutUpdate_TriC(in_update->target, in_update->src1, in_update->src2);
-		return new_update;
+		new_update = *in_update;
 	}
 };
 
@@ -125,19 +126,24 @@ void printUpdateStream(int num_partitions, std::string fileName, Update_Stream i
 	}
 }
 
+// the listed triangles, with the vertex ids of the input graph even if the engine relabeled them
+void printTriangles(Engine & e, Update_Stream triangles){
+	for(int i = 0; i < e.num_partitions; i++) {
+		int fd_update = open((e.filename + "." + std::to_string(i) + ".update_stream_" + std::to_string(triangles)).c_str(), O_RDONLY);
+		assert(fd_update > 0);
 
-int main(int argc, char ** argv) {
-	if(argc != 3) {
-		fprintf(stderr, "usage: bin/triangle_count [input graph(edge list format) [num of partitions]]\n");
-		exit(-1);
-	}
-
-	Engine e(std::string(argv[1]), atoi(argv[2]), 0);
-	std::cout << Logger::generate_log_del(std::string("finish preprocessing"), 1) << std::endl;
+		long update_file_size = io_manager::get_filesize(fd_update);
+		std::vector<Triangle> update_local_buf(update_file_size / sizeof(Triangle));
+		io_manager::read_from_file(fd_update, (char*)update_local_buf.data(), update_file_size, 0);
+		close(fd_update);
 
-	// get running time (wall time)
-	auto start = std::chrono::high_resolution_clock::now();
+		for(const Triangle & t : update_local_buf)
+			std::cout << Triangle(e.get_original_id(t.a), e.get_original_id(t.b), e.get_original_id(t.c)) << std::endl;
+	}
+}
 
+// the original relational plan: both joins materialize every wedge to disk
+long count_by_join(Engine & e) {
 	//scatter phase first to generate updates
 	std::cout << "\n\n" << Logger::generate_log_del(std::string("scatter"), 1) << std::endl;
 	Scatter<BaseVertex, RInUpdate_TriC> scatter_phase(e);
@@ -156,13 +162,46 @@ int main(int argc, char ** argv) {
 	Update_Stream out_stream_2 = r2.join(out_stream_1);
 //	printUpdateStream<ROutUpdate_TriC>(e.num_partitions, e.filename, out_stream_2);
 
-	auto end = std::chrono::high_resolution_clock::now();
-	std::chrono::duration<double> diff = end - start;
-	std::cout << "Finish triangle counting. Running time : " << diff.count() << " s\n";
-
-	std::cout << "Triangle Counting : " << Global_Info::count(out_stream_2, sizeof(ROutUpdate_TriC), e) << std::endl;
+	return Global_Info::count(out_stream_2, sizeof(ROutUpdate_TriC), e);
 }
 
+int main(int argc, char ** argv) {
+	if(argc < 3 || argc > 6) {
+		fprintf(stderr, "usage: bin/triangle_count [input graph(edge list format) [num of partitions] [mode: count (default), list or join] [partitioning: vertices (default) or edges] [vertex order: original (default) or degree]]\n");
+		exit(-1);
+	}
+	std::string mode = argc > 3 ? std::string(argv[3]) : std::string("count");
+	if(mode != "count" && mode != "list" && mode != "join") {
+		fprintf(stderr, "unknown mode %s, expected count, list or join\n", argv[3]);
+		exit(-1);
+	}
+
+	Engine e(std::string(argv[1]), atoi(argv[2]), 0, Engine::parse_partition_type(argc > 4 ? argv[4] : nullptr), Engine::parse_vertex_order(argc > 5 ? argv[5] : nullptr));
+	std::cout << Logger::generate_log_del(std::string("finish preprocessing"), 1) << std::endl;
+
+	// get running time (wall time)
+	auto start = std::chrono::high_resolution_clock::now();
 
+	long num_triangles = 0;
+	if(mode == "join") {
+		num_triangles = count_by_join(e);
+	}
+	else {
+		std::cout << "\n\n" << Logger::generate_log_del(std::string("degree-ordered counting"), 1) << std::endl;
+		triangle_counting tc(e);
+		if(mode == "count") {
+			num_triangles = tc.count();
+		}
+		else {
+			Update_Stream triangles = tc.list();
+			printTriangles(e, triangles);
+			num_triangles = Global_Info::count(triangles, sizeof(Triangle), e);
+		}
+	}
 
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> diff = end - start;
+	std::cout << "Finish triangle counting. Running time : " << diff.count() << " s\n";
 
+	std::cout << "Triangle Counting : " << num_triangles << std::endl;
+}
@@ -23,6 +23,7 @@
 #include <queue>
 #include <mutex>
 #include <condition_variable>
+#include <future>
 
 #include <fstream>
 #include <cassert>
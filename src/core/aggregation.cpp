@@ -9,7 +9,9 @@
 
 namespace RStream {
 
-		Aggregation::Aggregation(Engine & e, bool label_f) : context(e), label_flag(label_f) {}
+		canonical_cache Aggregation::canonical_graphs;
+
+		Aggregation::Aggregation(Engine & e, bool label_f) : context(e), label_flag(label_f), pattern_ids_stream(-1) {}
 
 		Aggregation::~Aggregation() {}
 
@@ -18,6 +20,7 @@ namespace RStream {
 			atomic_num_producers = context.num_exec_threads;
 			atomic_partition_id = -1;
 			atomic_partition_number = context.num_partitions;
+			ready_partitions.reset();
 		}
 
 
@@ -27,19 +30,28 @@ namespace RStream {
 		 * @return: aggregation stream
 		 * */
 		Aggregation_Stream Aggregation::aggregate(Update_Stream in_update_stream, int sizeof_in_tuple) {
+			// pattern ids only describe the stream aggregated last
+			pattern_ids.clear();
+			canonical_pattern_ids.clear();
+
 			Aggregation_Stream stream_local = aggregate_local(in_update_stream, sizeof_in_tuple);
 			int sizeof_agg = get_out_size(sizeof_in_tuple);
 			Aggregation_Stream agg_stream = aggregate_global(stream_local, sizeof_agg);
 			delete_aggstream(stream_local);
+
+			pattern_ids_stream = agg_stream;
 			return agg_stream;
 		}
 
 
 		Update_Stream Aggregation::aggregate_filter(Update_Stream up_stream, Aggregation_Stream agg_stream, int sizeof_in_tuple, int threshold){
-			Update_Stream up_stream_shuffled_on_canonical = shuffle_upstream_canonicalgraph(up_stream, sizeof_in_tuple);
-			Update_Stream up_stream_filtered = aggregate_filter_local(up_stream_shuffled_on_canonical, agg_stream, sizeof_in_tuple, threshold);
-			MPhase::delete_upstream_static(up_stream_shuffled_on_canonical, context.num_partitions, context.filename);
-			return up_stream_filtered;
+			assert(agg_stream == pattern_ids_stream);
+
+			// one bit per pattern id, no need to shuffle the tuples on their canonical graph
+			std::vector<bool> frequent_patterns(pattern_ids.size(), false);
+			get_frequent_patterns(agg_stream, get_out_size(sizeof_in_tuple), threshold, frequent_patterns);
+
+			return aggregate_filter_local(up_stream, &frequent_patterns, sizeof_in_tuple);
 		}
 
 		void Aggregation::printout_aggstream(Aggregation_Stream agg_stream, int sizeof_in_tuple){
@@ -50,6 +62,14 @@ namespace RStream {
 			std::cout << "a, " << agg_stream << ", " << count << ", " << sizeof_agg << ", " << (count * sizeof_agg) << std::endl;
 		}
 
+		void Aggregation::printout_canonical_cache(){
+			long hits = canonical_graphs.get_hits(), misses = canonical_graphs.get_misses();
+			std::cout << "canonical cache: " << hits << " hits, " << misses << " misses";
+			if(hits + misses > 0)
+				std::cout << ", hit rate " << 100.0 * hits / (hits + misses) << "%";
+			std::cout << std::endl;
+		}
+
 		unsigned int Aggregation::get_count(Aggregation_Stream in_update_stream, int sizeof_agg){
 			unsigned int count_total = 0;
 			// push task into concurrent queue
@@ -89,7 +109,7 @@ namespace RStream {
 			}
 
 			// allocate global buffers for shuffling
-			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_in_agg);
+			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_in_agg, &ready_partitions);
 
 			// exec threads will do aggregate and push result patterns into shuffle buffers
 			std::vector<std::thread> exec_threads;
@@ -105,6 +125,9 @@ namespace RStream {
 			for(auto & t : exec_threads)
 				t.join();
 
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
 			for(auto &t : write_threads)
 				t.join();
 
@@ -116,146 +139,20 @@ namespace RStream {
 		}
 
 
-		Update_Stream Aggregation::shuffle_upstream_canonicalgraph(Update_Stream in_update_stream, int sizeof_in_tuple){
-			atomic_init();
-
-			Update_Stream update_c = Engine::update_count++;
-
-//			concurrent_queue<int> * task_queue = new concurrent_queue<int>(context.num_partitions);
-//			// push task into concurrent queue
-//			for(int partition_id = 0; partition_id < context.num_partitions; partition_id++) {
-//				task_queue->push(partition_id);
-//			}
-
-			concurrent_queue<std::tuple<int, long, long>>* task_queue = MPhase::divide_tasks(context.num_partitions, context.filename, in_update_stream, sizeof_in_tuple, CHUNK_SIZE);
-
-			// allocate global buffers for shuffling
-			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_in_tuple);
-
-			// exec threads will do aggregate and push result patterns into shuffle buffers
-			std::vector<std::thread> exec_threads;
-			for(int i = 0; i < context.num_exec_threads; i++)
-				exec_threads.push_back( std::thread([=] { this->shuffle_on_canonical_producer(in_update_stream, buffers_for_shuffle, task_queue, sizeof_in_tuple); } ));
-
-			// write threads will flush shuffle buffer to update out stream file as long as it's full
-			std::vector<std::thread> write_threads;
-			for(int i = 0; i < context.num_write_threads; i++)
-				write_threads.push_back(std::thread(&Aggregation::update_consumer, this, update_c, buffers_for_shuffle));
-
-			// join all threads
-			for(auto & t : exec_threads)
-				t.join();
-
-			for(auto &t : write_threads)
-				t.join();
-
-			delete[] buffers_for_shuffle;
-			delete task_queue;
-
-			return update_c;
-		}
-
-		void Aggregation::shuffle_on_canonical_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, int sizeof_in_tuple) {
-			std::tuple<int, long, long> task_id (-1, -1, -1);
-
-			// pop from queue
-			while(task_queue->test_pop_atomic(task_id)) {
-				int partition_id = std::get<0>(task_id);
-				long offset_task = std::get<1>(task_id);
-				long size_task = std::get<2>(task_id);
-				assert(partition_id != -1 && offset_task != -1 && size_task != -1);
-
-//				Logger::print_thread_info_locked("as a (shuffle-upstream-on-canonical) producer dealing with partition " + MPhase::get_string_task_tuple(task_id) + "\n");
-
-				int fd_update = open((context.filename + "." + std::to_string(partition_id) + ".update_stream_" + std::to_string(in_update_stream)).c_str(), O_RDONLY);
-				assert(fd_update > 0);
-
-				// get file size
-//				long update_file_size = io_manager::get_filesize(fd_update);
-				long update_file_size = size_task;
-
-				// streaming updates
-				char * update_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
-				long real_io_size = MPhase::get_real_io_size(IO_SIZE, sizeof_in_tuple);
-				int streaming_counter = update_file_size / real_io_size + 1;
-
-				long valid_io_size = 0;
-//				long offset = 0;
-				long offset = offset_task;
-
-				// for all streaming updates
-				for(int counter = 0; counter < streaming_counter; counter++) {
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-						valid_io_size = update_file_size - real_io_size * (streaming_counter - 1);
-					else
-						valid_io_size = real_io_size;
-
-					assert(valid_io_size % sizeof_in_tuple == 0);
-
-					io_manager::read_from_file(fd_update, update_local_buf, valid_io_size, offset);
-					offset += valid_io_size;
-
-					// streaming tuples in, do aggregation
-					for(long pos = 0; pos < valid_io_size; pos += sizeof_in_tuple) {
-						// get an in_update_tuple
-						MTuple in_update_tuple(sizeof_in_tuple);
-						MPhase::get_an_in_update(update_local_buf + pos, in_update_tuple);
-
-//						//for debugging only
-//						std::cout << "tuple: " << in_update_tuple << std::endl;
-
-						shuffle_on_canonical(in_update_tuple, buffers_for_shuffle);
-					}
-
-				}
-
-				free(update_local_buf);
-				close(fd_update);
-
-			}
-			atomic_num_producers--;
-
-		}
-
-		void Aggregation::shuffle_on_canonical(MTuple& in_update_tuple, global_buffer_for_mining ** buffers_for_shuffle){
-			// turn tuple to quick pattern
-			Quick_Pattern quick_pattern(in_update_tuple.get_size() * sizeof(Element_In_Tuple));
-			Pattern::turn_quick_pattern_pure(in_update_tuple, quick_pattern, label_flag);
-
-//			Canonical_Graph* cf = Pattern::turn_canonical_graph(quick_pattern, false);
-//			unsigned int hash = cf->get_hash();
-//			delete cf;
-
-			bliss::AbstractGraph* cf_bliss = Pattern::turn_canonical_graph_bliss(quick_pattern, false);
-			unsigned int hash = cf_bliss->get_hash();
-			delete cf_bliss;
-			unsigned int index = get_global_bucket_index(hash);
-
-			quick_pattern.clean();
-
-			//get tuple
-			insert_tuple_to_buffer(index, in_update_tuple, buffers_for_shuffle);
-
-//			//for debugging only
-//			std::cout << "tuple: " << in_update_tuple << " ==> " << index << std::endl;
-		}
-
-		void Aggregation::insert_tuple_to_buffer(int partition_id, std::vector<Element_In_Tuple>& in_update_tuple, global_buffer_for_mining** buffers_for_shuffle) {
+		void Aggregation::insert_tuple_to_buffer(int partition_id, std::vector<Element_In_Tuple>& in_update_tuple, local_buffer_for_mining ** local_buffers) {
 			char* out_update = reinterpret_cast<char*>(in_update_tuple.data());
-			global_buffer_for_mining* global_buf = buffer_manager_for_mining::get_global_buffer_for_mining(buffers_for_shuffle, context.num_partitions, partition_id);
-			global_buf->insert(out_update);
+			local_buffer_for_mining* local_buf = buffer_manager_for_mining::get_local_buffer_for_mining(local_buffers, context.num_partitions, partition_id);
+			local_buf->insert(out_update);
 		}
 
-		void Aggregation::insert_tuple_to_buffer(int partition_id, MTuple& in_update_tuple, global_buffer_for_mining** buffers_for_shuffle) {
+		void Aggregation::insert_tuple_to_buffer(int partition_id, MTuple& in_update_tuple, local_buffer_for_mining ** local_buffers) {
 			char* out_update = reinterpret_cast<char*>(in_update_tuple.get_elements());
-			global_buffer_for_mining* global_buf = buffer_manager_for_mining::get_global_buffer_for_mining(buffers_for_shuffle, context.num_partitions, partition_id);
-			global_buf->insert(out_update);
+			local_buffer_for_mining* local_buf = buffer_manager_for_mining::get_local_buffer_for_mining(local_buffers, context.num_partitions, partition_id);
+			local_buf->insert(out_update);
 		}
 
 
-		Update_Stream Aggregation::aggregate_filter_local(Update_Stream up_stream_shuffled_on_canonical, Aggregation_Stream agg_stream, int sizeof_in_tuple, int threshold){
+		Update_Stream Aggregation::aggregate_filter_local(Update_Stream up_stream, const std::vector<bool> * frequent_patterns, int sizeof_in_tuple){
 			atomic_init();
 
 			Update_Stream update_c = Engine::update_count++;
@@ -266,15 +163,15 @@ namespace RStream {
 //				task_queue->push(partition_id);
 //			}
 
-			concurrent_queue<std::tuple<int, long, long>>* task_queue = MPhase::divide_tasks(context.num_partitions, context.filename, up_stream_shuffled_on_canonical, sizeof_in_tuple, CHUNK_SIZE);
+			concurrent_queue<std::tuple<int, long, long>>* task_queue = MPhase::divide_tasks(context.num_partitions, context.filename, up_stream, sizeof_in_tuple, CHUNK_SIZE);
 
 			// allocate global buffers for shuffling
-			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_in_tuple);
+			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_in_tuple, &ready_partitions);
 
 			// exec threads will produce updates and push into shuffle buffers
 			std::vector<std::thread> exec_threads;
 			for(int i = 0; i < context.num_exec_threads; i++)
-				exec_threads.push_back( std::thread([=] { this->aggregate_filter_local_producer(up_stream_shuffled_on_canonical, buffers_for_shuffle, task_queue, sizeof_in_tuple, agg_stream, threshold); } ));
+				exec_threads.push_back( std::thread([=] { this->aggregate_filter_local_producer(up_stream, buffers_for_shuffle, task_queue, sizeof_in_tuple, frequent_patterns); } ));
 
 			// write threads will flush shuffle buffer to update out stream file as long as it's full
 			std::vector<std::thread> write_threads;
@@ -285,6 +182,9 @@ namespace RStream {
 			for(auto & t : exec_threads)
 				t.join();
 
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
 			for(auto &t : write_threads)
 				t.join();
 
@@ -294,8 +194,10 @@ namespace RStream {
 			return update_c;
 		}
 
-		void Aggregation::aggregate_filter_local_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, int sizeof_in_tuple, Aggregation_Stream agg_stream, int threshold){
-			int sizeof_agg = get_out_size(sizeof_in_tuple);
+		void Aggregation::aggregate_filter_local_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, int sizeof_in_tuple, const std::vector<bool> * frequent_patterns){
+			// stage tuples per partition locally, publish them to the shared buffers in batches
+			local_buffer_for_mining ** local_buffers = buffer_manager_for_mining::get_local_buffers_for_mining(buffers_for_shuffle, context.num_partitions);
+
 			std::tuple<int, long, long> task_id (-1, -1, -1);
 
 			// pop from queue
@@ -308,21 +210,6 @@ namespace RStream {
 //				Logger::print_thread_info_locked("as a (aggregate-filter) producer dealing with partition " + MPhase::get_string_task_tuple(task_id) + "\n");
 
 
-				int fd_agg = open((context.filename + "." + std::to_string(partition_id) + ".aggregate_stream_" + std::to_string(agg_stream)).c_str(), O_RDONLY);
-				assert(fd_agg > 0);
-				// get file size
-				long agg_file_size = io_manager::get_filesize(fd_agg);
-
-				// aggs are fully loaded into memory
-				char * agg_local_buf = (char *)malloc(agg_file_size);
-				io_manager::read_from_file(fd_agg, agg_local_buf, agg_file_size, 0);
-
-				//build hashmap for aggregation tuples
-				std::unordered_map<Canonical_Graph, int> map;
-				build_aggmap(map, agg_local_buf, agg_file_size, sizeof_agg);
-//				printout_cg_aggmap(map);
-
-
 				int fd_update = open((context.filename + "." + std::to_string(partition_id) + ".update_stream_" + std::to_string(in_update_stream)).c_str(), O_RDONLY);
 				assert(fd_update > 0);
 
@@ -330,28 +217,14 @@ namespace RStream {
 				long update_file_size = size_task;
 
 				// streaming updates
-				char * update_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
-				long real_io_size = MPhase::get_real_io_size(IO_SIZE, sizeof_in_tuple);
-				int streaming_counter = update_file_size / real_io_size + 1;
-
+				stream_reader update_reader(fd_update, offset_task, update_file_size, MPhase::get_real_io_size(IO_SIZE, sizeof_in_tuple));
+				char * update_local_buf = nullptr;
 				long valid_io_size = 0;
-//				long offset = 0;
-				long offset = offset_task;
 
 				// for all streaming updates
-				for(int counter = 0; counter < streaming_counter; counter++) {
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-						valid_io_size = update_file_size - real_io_size * (streaming_counter - 1);
-					else
-						valid_io_size = real_io_size;
-
+				while(update_reader.next(update_local_buf, valid_io_size)) {
 					assert(valid_io_size % sizeof_in_tuple == 0);
 
-					io_manager::read_from_file(fd_update, update_local_buf, valid_io_size, offset);
-					offset += valid_io_size;
-
 					// streaming updates in, do hash join
 					for(long pos = 0; pos < valid_io_size; pos += sizeof_in_tuple) {
 						// get an in_update_tuple
@@ -364,56 +237,65 @@ namespace RStream {
 //						std::cout << "in_update: \t" << in_update_tuple << std::endl;
 
 //						//for debugging
-//						std::cout << in_update_tuple << " --> " << filter_aggregate(in_update_tuple, map, threshold) << std::endl;
+//						std::cout << in_update_tuple << " --> " << filter_aggregate(in_update_tuple, *frequent_patterns) << std::endl;
 
-						if(!filter_aggregate(in_update_tuple, map, threshold)){
-							insert_tuple_to_buffer(partition_id, in_update_tuple, buffers_for_shuffle);
+						if(!filter_aggregate(in_update_tuple, *frequent_patterns)){
+							insert_tuple_to_buffer(partition_id, in_update_tuple, local_buffers);
 						}
 
 					}
 				}
 
-				free(update_local_buf);
-				free(agg_local_buf);
-
 				close(fd_update);
-				close(fd_agg);
 			}
 
+			buffer_manager_for_mining::release_local_buffers_for_mining(local_buffers, context.num_partitions);
 			atomic_num_producers--;
 		}
 
-		void Aggregation::build_aggmap(std::unordered_map<Canonical_Graph, int>& map, char* agg_local_buf, long agg_file_size, int sizeof_agg){
-			assert(agg_file_size % sizeof_agg == 0);
-			for(long pos = 0; pos < agg_file_size; pos += sizeof_agg){
-				//read aggregation pair
-				std::pair<Canonical_Graph, int> in_agg_pair;
-				get_an_in_agg_pair(agg_local_buf + pos, in_agg_pair, sizeof_agg);
-
-				assert(map.find(in_agg_pair.first) == map.end());
-				map.insert(in_agg_pair);
-			}
-		}
+		void Aggregation::get_frequent_patterns(Aggregation_Stream agg_stream, int sizeof_agg, int threshold, std::vector<bool> & frequent_patterns){
+			for(int partition_id = 0; partition_id < context.num_partitions; partition_id++) {
+				int fd_agg = open((context.filename + "." + std::to_string(partition_id) + ".aggregate_stream_" + std::to_string(agg_stream)).c_str(), O_RDONLY);
+				assert(fd_agg > 0);
+				// get file size
+				long agg_file_size = io_manager::get_filesize(fd_agg);
+				assert(agg_file_size % sizeof_agg == 0);
 
-		bool Aggregation::filter_aggregate(MTuple & update_tuple, std::unordered_map<Canonical_Graph, int>& map, int threshold){
-//			// turn tuple to quick pattern
-//			Quick_Pattern quick_pattern;
-//			Pattern::turn_quick_pattern_pure(update_tuple, quick_pattern, label_flag);
-//			std::vector<Element_In_Tuple> sub_graph = quick_pattern.get_tuple();
+				// aggs are fully loaded into memory
+				char * agg_local_buf = (char *)malloc(agg_file_size);
+				io_manager::read_from_file(fd_agg, agg_local_buf, agg_file_size, 0);
 
-			// turn tuple to quick pattern
-			Quick_Pattern quick_pattern(update_tuple.get_size() * sizeof(Element_In_Tuple));
-			Pattern::turn_quick_pattern_pure(update_tuple, quick_pattern, label_flag);
+				for(long pos = 0; pos < agg_file_size; pos += sizeof_agg){
+					//read aggregation pair
+					std::pair<Canonical_Graph, int> in_agg_pair;
+					get_an_in_agg_pair(agg_local_buf + pos, in_agg_pair, sizeof_agg);
 
-			Canonical_Graph* cf = Pattern::turn_canonical_graph(quick_pattern, false);
+					auto it = pattern_ids.find(in_agg_pair.first);
+					assert(it != pattern_ids.end());
+					frequent_patterns[it->second] = (in_agg_pair.second >= threshold);
+				}
 
-			quick_pattern.clean();
+				free(agg_local_buf);
+				close(fd_agg);
+			}
+		}
 
-			assert(map.find(*cf) != map.end());
-			bool r = (map[*cf] < threshold);
+		bool Aggregation::filter_aggregate(MTuple & update_tuple, const std::vector<bool> & frequent_patterns){
+			// every pattern of the stream got its canonical pattern during aggregation
+			auto it = canonical_pattern_ids.find(update_tuple.get_pattern_id());
+			assert(it != canonical_pattern_ids.end());
+			return !frequent_patterns[it->second];
+		}
 
-			delete cf;
-			return r;
+		void Aggregation::register_pattern_ids(std::vector<std::pair<unsigned int, const Canonical_Graph*>> & patterns){
+			std::unique_lock<std::mutex> lock(pattern_ids_mutex);
+			for(auto it = patterns.begin(); it != patterns.end(); ++it){
+				auto it_id = pattern_ids.find(*it->second);
+				if(it_id == pattern_ids.end()){
+					it_id = pattern_ids.insert(std::make_pair(*it->second, (unsigned int)pattern_ids.size())).first;
+				}
+				canonical_pattern_ids[it->first] = it_id->second;
+			}
 		}
 
 		Aggregation_Stream Aggregation::aggregate_local(Update_Stream in_update_stream, int sizeof_in_tuple) {
@@ -435,7 +317,7 @@ namespace RStream {
 			int sizeof_output = get_out_size(sizeof_in_tuple);
 //			std::cout << "size_of_in_tuple = " << sizeof_in_tuple << ", size_of_agg = " << sizeof_output << std::endl;
 			// allocate global buffers for shuffling
-			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_output);
+			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_output, &ready_partitions);
 
 			// exec threads will do aggregate and push result patterns into shuffle buffers
 			std::vector<std::thread> exec_threads;
@@ -451,6 +333,9 @@ namespace RStream {
 			for(auto & t : exec_threads)
 				t.join();
 
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
 			for(auto &t : write_threads)
 				t.join();
 
@@ -501,31 +386,17 @@ namespace RStream {
 				// get file size
 				long agg_file_size = io_manager::get_filesize(fd_agg);
 
-				char * agg_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
-				long real_io_size = MPhase::get_real_io_size(IO_SIZE, sizeof_in_agg);
-				int streaming_counter = agg_file_size / real_io_size + 1;
-//				std::cout << "streaming counter: " << streaming_counter << std::endl;
-
+				stream_reader agg_reader(fd_agg, 0, agg_file_size, MPhase::get_real_io_size(IO_SIZE, sizeof_in_agg));
+				char * agg_local_buf = nullptr;
 				long valid_io_size = 0;
-				long offset = 0;
 
 				// for all streaming updates
-				for(int counter = 0; counter < streaming_counter; counter++) {
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-						valid_io_size = agg_file_size - real_io_size * (streaming_counter - 1);
-					else
-						valid_io_size = real_io_size;
-
+				while(agg_reader.next(agg_local_buf, valid_io_size)) {
 					assert(valid_io_size % sizeof_in_agg == 0);
 
-
 	//				// streaming updates
 	//				char * agg_local_buf = (char *)malloc(agg_file_size);
 
-					io_manager::read_from_file(fd_agg, agg_local_buf, valid_io_size, offset);
-					offset += valid_io_size;
 
 					for(long pos = 0; pos < valid_io_size; pos += sizeof_in_agg) {
 						// get an in_update_tuple
@@ -542,30 +413,29 @@ namespace RStream {
 				std::string file_name (context.filename + "." + std::to_string(partition_id) + ".aggregate_stream_" + std::to_string(out_agg_stream));
 				write_canonical_aggregation(canonical_graphs_aggregation, file_name, sizeof_in_agg);
 
-				free(agg_local_buf);
 				close(fd_agg);
 
 			}
 		}
 
-		void shuffle(MTuple_simple& out_update_tuple, global_buffer_for_mining ** buffers_for_shuffle, int partition_id, int num_parts) {
+		void shuffle(MTuple_simple& out_update_tuple, local_buffer_for_mining ** local_buffers, int partition_id, int num_parts) {
 //			unsigned int hash = out_update_tuple.get_hash();
 //			unsigned int index = hash % context.num_partitions;
 //			global_buffer_for_mining* global_buf = buffer_manager_for_mining::get_global_buffer_for_mining(buffers_for_shuffle, context.num_partitions, index);
 
-			global_buffer_for_mining* global_buf = buffer_manager_for_mining::get_global_buffer_for_mining(buffers_for_shuffle, num_parts, partition_id);
+			local_buffer_for_mining* local_buf = buffer_manager_for_mining::get_local_buffer_for_mining(local_buffers, num_parts, partition_id);
 			char* out_update = reinterpret_cast<char*>(out_update_tuple.get_elements());
 //			std::cout << *((Base_Element*)out_update) << std::endl;
 //			std::cout << *((Base_Element*)added) << std::endl;
-			global_buf->insert(out_update);
+			local_buf->insert(out_update);
 
 		}
 
-		void aggregate_clique(global_buffer_for_mining ** buffers_for_shuffle, std::unordered_map<MTuple_simple, unsigned int>& mtuple_simple_aggregation, MTuple_simple& in_update_tuple, int partition_id, int num_parts){
+		void aggregate_clique(local_buffer_for_mining ** local_buffers, std::unordered_map<MTuple_simple, unsigned int>& mtuple_simple_aggregation, MTuple_simple& in_update_tuple, int partition_id, int num_parts){
 			auto it = mtuple_simple_aggregation.find(in_update_tuple);
 			if(it != mtuple_simple_aggregation.end()){
 				if(it->second == it->first.get_size() - 2){
-					shuffle(in_update_tuple, buffers_for_shuffle, partition_id, num_parts);
+					shuffle(in_update_tuple, local_buffers, partition_id, num_parts);
 					mtuple_simple_aggregation.erase(it);
 				}
 				else{
@@ -578,6 +448,9 @@ namespace RStream {
 		}
 
 		void Aggregation::aggregate_filter_clique_per_thread(global_buffer_for_mining ** buffers_for_shuffle, Update_Stream in_agg_stream, concurrent_queue<int> * task_queue, int sizeof_in_mtuple, Update_Stream out_agg_stream) {
+			// stage tuples per partition locally, publish them to the shared buffers in batches
+			local_buffer_for_mining ** local_buffers = buffer_manager_for_mining::get_local_buffers_for_mining(buffers_for_shuffle, context.num_partitions);
+
 			int partition_id = -1;
 
 			// pop from queue
@@ -595,37 +468,24 @@ namespace RStream {
 
 				// streaming edges
 //				int size_of_unit = context.edge_unit;
-				char * agg_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
-				long real_io_size = MPhase::get_real_io_size(IO_SIZE, sizeof_in_mtuple);
-				int streaming_counter = agg_file_size / real_io_size + 1;
-
+				stream_reader agg_reader(fd_agg, 0, agg_file_size, MPhase::get_real_io_size(IO_SIZE, sizeof_in_mtuple));
+				char * agg_local_buf = nullptr;
 				long valid_io_size = 0;
-				long offset = 0;
 
 				// for all streaming
-				for(int counter = 0; counter < streaming_counter; counter++) {
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-						valid_io_size = agg_file_size - real_io_size * (streaming_counter - 1);
-					else
-						valid_io_size = real_io_size;
-
+				while(agg_reader.next(agg_local_buf, valid_io_size)) {
 					if(valid_io_size % sizeof_in_mtuple != 0){
 						std::cout << valid_io_size << ", " << sizeof_in_mtuple << std::endl;
 					}
 					assert(valid_io_size % sizeof_in_mtuple == 0);
 
-					io_manager::read_from_file(fd_agg, agg_local_buf, valid_io_size, offset);
-					offset += valid_io_size;
-
 					for(long pos = 0; pos < valid_io_size; pos += sizeof_in_mtuple) {
 						// get an in_update_tuple
 						MTuple_simple in_update_tuple(sizeof_in_mtuple);
 						MPhase::get_an_in_update(agg_local_buf + pos, in_update_tuple);
 	//					std::cout << in_update_tuple << std::endl;
 
-						aggregate_clique(buffers_for_shuffle, *mtuple_simple_aggregation, in_update_tuple, partition_id, context.num_partitions);
+						aggregate_clique(local_buffers, *mtuple_simple_aggregation, in_update_tuple, partition_id, context.num_partitions);
 					}
 				}
 
@@ -648,9 +508,9 @@ namespace RStream {
 				delete mtuple_simple_aggregation;
 
 //				std::cout << "done partition " << partition_id << std::endl;
-				free(agg_local_buf);
 				close(fd_agg);
 			}
+			buffer_manager_for_mining::release_local_buffers_for_mining(local_buffers, context.num_partitions);
 			atomic_num_producers--;
 		}
 
@@ -798,6 +658,9 @@ namespace RStream {
 
 
 		void Aggregation::aggregate_local_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, int sizeof_in_tuple) {
+			// stage tuples per partition locally, publish them to the shared buffers in batches
+			local_buffer_for_mining ** local_buffers = buffer_manager_for_mining::get_local_buffers_for_mining(buffers_for_shuffle, context.num_partitions);
+
 			std::tuple<int, long, long> task_id (-1, -1, -1);
 
 			// pop from queue
@@ -817,29 +680,17 @@ namespace RStream {
 				long update_file_size = size_task;
 
 				// streaming updates
-				char * update_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
-				long real_io_size = MPhase::get_real_io_size(IO_SIZE, sizeof_in_tuple);
-				int streaming_counter = update_file_size / real_io_size + 1;
-
+				stream_reader update_reader(fd_update, offset_task, update_file_size, MPhase::get_real_io_size(IO_SIZE, sizeof_in_tuple));
+				char * update_local_buf = nullptr;
 				long valid_io_size = 0;
-//				long offset = 0;
-				long offset = offset_task;
 
-				std::unordered_map<Quick_Pattern, int> quick_patterns_aggregation;
+				// tuples carry their pattern id, so local aggregation is a histogram over ids
+				std::unordered_map<unsigned int, int> pattern_counts;
 
 				// for all streaming updates
-				for(int counter = 0; counter < streaming_counter; counter++) {
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-						valid_io_size = update_file_size - real_io_size * (streaming_counter - 1);
-					else
-						valid_io_size = real_io_size;
+				while(update_reader.next(update_local_buf, valid_io_size)) {
 					assert(valid_io_size % sizeof_in_tuple == 0);
 
-					io_manager::read_from_file(fd_update, update_local_buf, valid_io_size, offset);
-					offset += valid_io_size;
-
 					// streaming tuples in, do aggregation
 					for(long pos = 0; pos < valid_io_size; pos += sizeof_in_tuple) {
 						// get an in_update_tuple
@@ -850,38 +701,32 @@ namespace RStream {
 						MPhase::get_an_in_update(update_local_buf + pos, in_update_tuple);
 //						std::cout << "in_update: \t" << in_update_tuple << std::endl;
 
-						// turn tuple to quick pattern
-						Quick_Pattern quick_pattern(sizeof_in_tuple);
-						Pattern::turn_quick_pattern_pure(in_update_tuple, quick_pattern, label_flag);
-//						std::cout << "quick_pattern: \t" << quick_pattern << std::endl;
-//						std::cout << "in_update: \t" << in_update_tuple << std::endl;
-//						std::cout << std::endl;
-						aggregate_on_quick_pattern(quick_patterns_aggregation, quick_pattern);
+						pattern_counts[in_update_tuple.get_pattern_id()]++;
 					}
 
 //					//for debugging
-//					printout_quickpattern_aggmap(quick_patterns_aggregation);
+//					printout_pattern_counts(pattern_counts);
 
 				}
 
 				std::unordered_map<Canonical_Graph, int> canonical_graphs_aggregation;
-				aggregate_on_canonical_graph(canonical_graphs_aggregation, quick_patterns_aggregation);
+				aggregate_on_canonical_graph(canonical_graphs_aggregation, pattern_counts);
 
 				// for each canonical graph, do map reduce, shuffle to corresponding buckets
-				shuffle_canonical_aggregation(canonical_graphs_aggregation, buffers_for_shuffle);
+				shuffle_canonical_aggregation(canonical_graphs_aggregation, local_buffers);
 
-				free(update_local_buf);
 				close(fd_update);
 
 			}
+			buffer_manager_for_mining::release_local_buffers_for_mining(local_buffers, context.num_partitions);
 			atomic_num_producers--;
 		}
 
 		//for debugging only
-		void Aggregation::printout_quickpattern_aggmap(std::unordered_map<Quick_Pattern, int>& quick_patterns_aggregation){
-			std::cout << "quick pattern map: \n";
-			for(auto it = quick_patterns_aggregation.begin(); it != quick_patterns_aggregation.end(); ++it){
-				std::cout << it->first << " --> " << it->second << std::endl;
+		void Aggregation::printout_pattern_counts(std::unordered_map<unsigned int, int>& pattern_counts){
+			std::cout << "pattern counts: \n";
+			for(auto it = pattern_counts.begin(); it != pattern_counts.end(); ++it){
+				std::cout << it->first << ": " << pattern_table::get_instance().get_pattern(it->first) << " --> " << it->second << std::endl;
 			}
 			std::cout << std::endl;
 		}
@@ -895,28 +740,23 @@ namespace RStream {
 			std::cout << std::endl;
 		}
 
-		void Aggregation::aggregate_on_quick_pattern(std::unordered_map<Quick_Pattern, int>& quick_patterns_aggregation, Quick_Pattern& quick_pattern){
-			if(quick_patterns_aggregation.find(quick_pattern) != quick_patterns_aggregation.end()){
-				quick_patterns_aggregation[quick_pattern] = quick_patterns_aggregation[quick_pattern] + 1;
-				quick_pattern.clean();
-			}
-			else{
-				quick_patterns_aggregation[quick_pattern] = 1;
-			}
-
-		}
+		void Aggregation::aggregate_on_canonical_graph(std::unordered_map<Canonical_Graph, int>& canonical_graphs_aggregation, std::unordered_map<unsigned int, int>& pattern_counts){
+			pattern_table & quick_patterns = pattern_table::get_instance();
+			std::vector<std::pair<unsigned int, const Canonical_Graph*>> patterns;
+			patterns.reserve(pattern_counts.size());
 
-		void Aggregation::aggregate_on_canonical_graph(std::unordered_map<Canonical_Graph, int>& canonical_graphs_aggregation, std::unordered_map<Quick_Pattern, int>& quick_patterns_aggregation){
-			for(auto it = quick_patterns_aggregation.begin(); it != quick_patterns_aggregation.end(); ++it){
-				Quick_Pattern sub_graph = it->first;
+			for(auto it = pattern_counts.begin(); it != pattern_counts.end(); ++it){
+				Quick_Pattern sub_graph = quick_patterns.get_pattern(it->first);
+				if(!label_flag){
+					for(unsigned int i = 0; i < sub_graph.get_size(); ++i){
+						sub_graph.at(i).vertex_label = (BYTE)0;
+					}
+				}
 //				std::cout << "quick_pattern: \t" << sub_graph << std::endl;
 				int s = it->second;
-				Canonical_Graph* cg = Pattern::turn_canonical_graph(sub_graph, false);
+				const Canonical_Graph* cg = canonical_graphs.get_canonical_graph(sub_graph);
 //				std::cout << "canonical_graph: \t" << *cg << std::endl;
 
-				//clean quick_pattern
-				sub_graph.clean();
-
 //				std::cout << (canonical_graphs_aggregation.find(*cg) != canonical_graphs_aggregation.end()) << std::endl;
 				if(canonical_graphs_aggregation.find(*cg) != canonical_graphs_aggregation.end()){
 					canonical_graphs_aggregation[*cg] = canonical_graphs_aggregation[*cg] + s;
@@ -925,25 +765,27 @@ namespace RStream {
 					canonical_graphs_aggregation[*cg] = s;
 				}
 
-
-				delete cg;
+				patterns.push_back(std::make_pair(it->first, cg));
 			}
 
+			// give the patterns their ids, filtering looks them up through the cache
+			register_pattern_ids(patterns);
+
 //			//for debugging only
 //			printout_cg_aggmap(canonical_graphs_aggregation);
 		}
 
 
-		void Aggregation::shuffle_canonical_aggregation(std::unordered_map<Canonical_Graph, int>& canonical_graphs_aggregation, global_buffer_for_mining ** buffers_for_shuffle){
+		void Aggregation::shuffle_canonical_aggregation(std::unordered_map<Canonical_Graph, int>& canonical_graphs_aggregation, local_buffer_for_mining ** local_buffers){
 			for(auto it = canonical_graphs_aggregation.begin(); it != canonical_graphs_aggregation.end(); ++it) {
 				Canonical_Graph canonical_graph = it->first;
 
 				unsigned int hash = canonical_graph.get_hash();
 				unsigned int index = get_global_bucket_index(hash);
 //				std::cout << "hash: \t" << hash << ", \tindex: \t" << index << std::endl;
-				global_buffer_for_mining* global_buf = buffer_manager_for_mining::get_global_buffer_for_mining(buffers_for_shuffle, context.num_partitions, index);
+				local_buffer_for_mining* local_buf = buffer_manager_for_mining::get_local_buffer_for_mining(local_buffers, context.num_partitions, index);
 
-				char* out_agg_pair = convert_to_bytes(global_buf->get_sizeoftuple(), (*it));
+				char* out_agg_pair = convert_to_bytes(local_buf->get_sizeoftuple(), (*it));
 //				int s = it->second;
 //				char* out_cg = (char *)malloc(global_buf->get_sizeoftuple());
 //				size_t s_vector = global_buf->get_sizeoftuple()- sizeof(unsigned int) * 2 - sizeof(int);
@@ -956,7 +798,7 @@ namespace RStream {
 //				std::memcpy(out_cg + s_vector + sizeof(unsigned int) * 2, &s, sizeof(int));
 
 				// TODO: insert
-				global_buf->insert(out_agg_pair);
+				local_buf->insert(out_agg_pair);
 				delete out_agg_pair;
 			}
 		}
@@ -964,14 +806,11 @@ namespace RStream {
 
 		// each writer thread generates a join_consumer
 		void Aggregation::aggregate_consumer(Aggregation_Stream aggregation_stream, global_buffer_for_mining ** buffers_for_shuffle) {
-			while(atomic_num_producers != 0) {
-				int i = (++atomic_partition_id) % context.num_partitions;
-
+			// flush the buffers producers report as full, until all producers are done
+			for(int i = -1; ready_partitions.pop(i); ) {
 				std::string file_name (context.filename + "." + std::to_string(i) + ".aggregate_stream_" + std::to_string(aggregation_stream));
 				global_buffer_for_mining* g_buf = buffer_manager_for_mining::get_global_buffer_for_mining(buffers_for_shuffle, context.num_partitions, i);
 				g_buf->flush(file_name, i);
-
-				atomic_partition_id = atomic_partition_id % context.num_partitions;
 			}
 
 			//the last run - deal with all remaining content in buffers
@@ -993,14 +832,11 @@ namespace RStream {
 		}
 
 		void Aggregation::update_consumer(Update_Stream out_update_stream, global_buffer_for_mining ** buffers_for_shuffle) {
-			while(atomic_num_producers != 0) {
-				int i = (++atomic_partition_id) % context.num_partitions;
-
+			// flush the buffers producers report as full, until all producers are done
+			for(int i = -1; ready_partitions.pop(i); ) {
 				std::string file_name (context.filename + "." + std::to_string(i) + ".update_stream_" + std::to_string(out_update_stream));
 				global_buffer_for_mining* g_buf = buffer_manager_for_mining::get_global_buffer_for_mining(buffers_for_shuffle, context.num_partitions, i);
 				g_buf->flush(file_name, i);
-
-				atomic_partition_id = atomic_partition_id % context.num_partitions;
 			}
 
 			//the last run - deal with all remaining content in buffers
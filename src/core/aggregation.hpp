@@ -9,6 +9,7 @@
 #define SRC_CORE_AGGREGATION_HPP_
 
 #include "mining_phase.hpp"
+#include "canonical_cache.hpp"
 
 namespace RStream {
 
@@ -30,12 +31,23 @@ namespace RStream {
 		 * */
 		Aggregation_Stream aggregate(Update_Stream in_update_stream, int sizeof_in_tuple);
 
+		/*
+		 * keep the tuples whose pattern is frequent
+		 * @param: agg_stream must come from the last call to aggregate on up_stream, whose pattern ids are reused
+		 * */
 		Update_Stream aggregate_filter(Update_Stream up_stream, Aggregation_Stream agg_stream, int sizeof_in_tuple, int threshold);
 
 		void printout_aggstream(Aggregation_Stream agg_stream, int sizeof_in_tuple);
 
+		// hits and misses of the canonical graph cache so far, over all aggregations of the process
+		void printout_canonical_cache();
+
 		void delete_aggstream(Aggregation_Stream agg_stream);
 
+		static const canonical_cache & get_canonical_cache() {
+			return canonical_graphs;
+		}
+
 		Update_Stream aggregate_filter_clique(Update_Stream in_agg_stream, int sizeof_in_agg);
 
 
@@ -79,30 +91,38 @@ namespace RStream {
 		std::atomic<int> atomic_num_producers;
 		std::atomic<int> atomic_partition_id;
 		std::atomic<int> atomic_partition_number;
+		// ids of shuffle buffers ready to be flushed, consumed by the writer threads
+		blocking_queue<int> ready_partitions;
 
 		bool label_flag;
 
+		// compact ids of the canonical patterns found by the last aggregation
+		std::mutex pattern_ids_mutex;
+		std::unordered_map<Canonical_Graph, unsigned int> pattern_ids;
+		// pattern id of the tuples (see pattern_table) -> id of its canonical pattern
+		std::unordered_map<unsigned int, unsigned int> canonical_pattern_ids;
+		Aggregation_Stream pattern_ids_stream;
 
-		/* Private Functions */
-		void atomic_init();
+		// canonical graph of every quick pattern seen so far, shared by all aggregations and filters
+		static canonical_cache canonical_graphs;
 
-		Update_Stream shuffle_upstream_canonicalgraph(Update_Stream in_update_stream, int sizeof_in_tuple);
 
-		void shuffle_on_canonical_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, int sizeof_in_tuple);
+		/* Private Functions */
+		void atomic_init();
 
-		void shuffle_on_canonical(MTuple& in_update_tuple, global_buffer_for_mining ** buffers_for_shuffle);
+		void insert_tuple_to_buffer(int partition_id, std::vector<Element_In_Tuple>& in_update_tuple, local_buffer_for_mining ** local_buffers);
+		void insert_tuple_to_buffer(int partition_id, MTuple& in_update_tuple, local_buffer_for_mining ** local_buffers);
 
-		void insert_tuple_to_buffer(int partition_id, std::vector<Element_In_Tuple>& in_update_tuple, global_buffer_for_mining** buffers_for_shuffle);
-		void insert_tuple_to_buffer(int partition_id, MTuple& in_update_tuple, global_buffer_for_mining** buffers_for_shuffle);
 
+		Update_Stream aggregate_filter_local(Update_Stream up_stream, const std::vector<bool> * frequent_patterns, int sizeof_in_tuple);
 
-		Update_Stream aggregate_filter_local(Update_Stream up_stream_shuffled_on_canonical, Aggregation_Stream agg_stream, int sizeof_in_tuple, int threshold);
+		void aggregate_filter_local_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, int sizeof_in_tuple, const std::vector<bool> * frequent_patterns);
 
-		void aggregate_filter_local_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, int sizeof_in_tuple, Aggregation_Stream agg_stream, int threshold);
+		void get_frequent_patterns(Aggregation_Stream agg_stream, int sizeof_agg, int threshold, std::vector<bool> & frequent_patterns);
 
-		void build_aggmap(std::unordered_map<Canonical_Graph, int>& map, char* agg_local_buf, long agg_file_size, int sizeof_agg);
+		bool filter_aggregate(MTuple & update_tuple, const std::vector<bool> & frequent_patterns);
 
-		bool filter_aggregate(MTuple & update_tuple, std::unordered_map<Canonical_Graph, int>& map, int threshold);
+		void register_pattern_ids(std::vector<std::pair<unsigned int, const Canonical_Graph*>> & patterns);
 
 		Aggregation_Stream aggregate_local(Update_Stream in_update_stream, int sizeof_in_tuple);
 
@@ -119,17 +139,15 @@ namespace RStream {
 		void aggregate_local_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, int sizeof_in_tuple);
 
 		//for debugging only
-		void printout_quickpattern_aggmap(std::unordered_map<Quick_Pattern, int>& quick_patterns_aggregation);
+		void printout_pattern_counts(std::unordered_map<unsigned int, int>& pattern_counts);
 
 		//for debugging only
 		void printout_cg_aggmap(std::unordered_map<Canonical_Graph, int>& canonical_graphs_aggregation);
 
-		void aggregate_on_quick_pattern(std::unordered_map<Quick_Pattern, int>& quick_patterns_aggregation, Quick_Pattern& quick_pattern);
-
-		void aggregate_on_canonical_graph(std::unordered_map<Canonical_Graph, int>& canonical_graphs_aggregation, std::unordered_map<Quick_Pattern, int>& quick_patterns_aggregation);
+		void aggregate_on_canonical_graph(std::unordered_map<Canonical_Graph, int>& canonical_graphs_aggregation, std::unordered_map<unsigned int, int>& pattern_counts);
 
 
-		void shuffle_canonical_aggregation(std::unordered_map<Canonical_Graph, int>& canonical_graphs_aggregation, global_buffer_for_mining ** buffers_for_shuffle);
+		void shuffle_canonical_aggregation(std::unordered_map<Canonical_Graph, int>& canonical_graphs_aggregation, local_buffer_for_mining ** local_buffers);
 
 		// each writer thread generates a join_consumer
 		void aggregate_consumer(Aggregation_Stream aggregation_stream, global_buffer_for_mining ** buffers_for_shuffle);
@@ -12,6 +12,7 @@
 #include "../utility/Logger.hpp"
 #include "constants.hpp"
 #include "io_manager.hpp"
+#include "concurrent_queue.hpp"
 
 namespace RStream {
 
@@ -20,134 +21,138 @@ namespace RStream {
 	// that's why we don't use template
 	// TODO: buffer_manager needs to be rewritten later.
 
+	// The buffer is split into NUM_BUFFER_SEGMENTS segments. Producers reserve slots in the active
+	// segment with an atomic fetch-add and copy without taking the lock; the producer completing a
+	// segment seals it and switches to a free one, so the writer flushes the sealed segment to disk
+	// while the others keep appending.
 	class global_buffer_for_mining {
+		struct segment {
+			char * buf;
+			std::atomic<size_t> reserved;
+			std::atomic<size_t> committed;
+		};
+
 		size_t capacity;
-		size_t count;
 		size_t sizeof_tuple;
-		size_t index;
-		char * buf;
+		int id;
+		blocking_queue<int> * ready_queue;
+		segment * segments;
+		std::atomic<segment*> active;
+		std::atomic<size_t> generation;
+		std::deque<segment*> sealed_segments;
+		std::deque<segment*> free_segments;
 		std::mutex mutex;
+		std::mutex write_mutex;
 		std::condition_variable not_full;
 
 	public:
-		global_buffer_for_mining(size_t _capacity, size_t _sizeof_tuple) :
-			capacity{_capacity}, count(0), sizeof_tuple(_sizeof_tuple), index(0) {
-			buf = new char[sizeof_tuple * capacity];
+		global_buffer_for_mining(size_t _capacity, size_t _sizeof_tuple, int _id, blocking_queue<int> * _ready_queue) :
+			sizeof_tuple(_sizeof_tuple), id(_id), ready_queue(_ready_queue) {
+			capacity = std::max((size_t)1, _capacity / NUM_BUFFER_SEGMENTS);
+			segments = new segment[NUM_BUFFER_SEGMENTS];
+			for(int i = 0; i < NUM_BUFFER_SEGMENTS; i++) {
+				segments[i].buf = new char[sizeof_tuple * capacity];
+				// closed until activated, so that stale reservations fail
+				segments[i].reserved = capacity;
+				segments[i].committed = 0;
+				if(i != 0)
+					free_segments.push_back(&segments[i]);
+			}
+			segments[0].reserved = 0;
+			active = &segments[0];
+			generation = 0;
 		}
 
 		~global_buffer_for_mining() {
-			delete[] buf;
+			for(int i = 0; i < NUM_BUFFER_SEGMENTS; i++) {
+				delete[] segments[i].buf;
+			}
+			delete[] segments;
 		}
 
 		void insert(char * tuple) {
-			std::unique_lock<std::mutex> lock(mutex);
-			not_full.wait(lock, [&] {return !is_full();});
+			size_t pos, n;
+			segment * seg = reserve(1, pos, n);
 
 			// insert tuple to buffer
-			std::memcpy(buf + index, tuple, sizeof_tuple);
-			index += sizeof_tuple;
-			count++;
+			std::memcpy(seg->buf + pos * sizeof_tuple, tuple, sizeof_tuple);
+			commit(seg, n);
 		}
 
 		void insert(char * tuple, char* extra_element) {
-			std::unique_lock<std::mutex> lock(mutex);
-			not_full.wait(lock, [&] {return !is_full();});
+			size_t pos, n;
+			segment * seg = reserve(1, pos, n);
 
 			// insert tuple to buffer
-			std::memcpy(buf + index, tuple, sizeof_tuple - sizeof(Element_In_Tuple));
-			std::memcpy(buf + index + sizeof_tuple - sizeof(Element_In_Tuple), extra_element, sizeof(Element_In_Tuple));
-			index += sizeof_tuple;
-			count++;
+			char * dst = seg->buf + pos * sizeof_tuple;
+			std::memcpy(dst, tuple, sizeof_tuple - sizeof(Element_In_Tuple));
+			std::memcpy(dst + sizeof_tuple - sizeof(Element_In_Tuple), extra_element, sizeof(Element_In_Tuple));
+			commit(seg, n);
 		}
 
 		void insert_simple(char * tuple, char* extra_element) {
-			std::unique_lock<std::mutex> lock(mutex);
-			not_full.wait(lock, [&] {return !is_full();});
+			size_t pos, n;
+			segment * seg = reserve(1, pos, n);
 
 			// insert tuple to buffer
-			std::memcpy(buf + index, tuple, sizeof_tuple - sizeof(Base_Element));
-			std::memcpy(buf + index + sizeof_tuple - sizeof(Base_Element), extra_element, sizeof(Base_Element));
-			index += sizeof_tuple;
-			count++;
+			char * dst = seg->buf + pos * sizeof_tuple;
+			std::memcpy(dst, tuple, sizeof_tuple - sizeof(Base_Element));
+			std::memcpy(dst + sizeof_tuple - sizeof(Base_Element), extra_element, sizeof(Base_Element));
+			commit(seg, n);
 		}
 
-//		void flush(const char * file_name, const int i) {
-//			std::unique_lock<std::mutex> lock(mutex);
-//
-//			if(is_full()){
-//				int perms = O_WRONLY | O_APPEND;
-//				int fd = open(file_name, perms, S_IRWXU);
-//				if(fd < 0){
-//					fd = creat(file_name, S_IRWXU);
-//				}
-//				// flush buffer to update out stream
-//				io_manager::write_to_file(fd, buf, capacity * sizeof_tuple);
-//				close(fd);
-//
-//				count = 0;
-//				not_full.notify_all();
-//			}
-//		}
-
-		void flush(std::string& file_name_str, const int i) {
-			std::unique_lock<std::mutex> lock(mutex);
+		// insert a block of num_tuples packed tuples, spilling over into the next segment if needed
+		void insert_batch(char * tuples, size_t num_tuples) {
+			while(num_tuples > 0) {
+				size_t pos, n;
+				segment * seg = reserve(num_tuples, pos, n);
 
-			if(is_full()){
-				const char * file_name = file_name_str.c_str();
-				int perms = O_WRONLY | O_APPEND;
-				int fd = open(file_name, perms, S_IRWXU);
-				if(fd < 0){
-					fd = creat(file_name, S_IRWXU);
-				}
-				// flush buffer to update out stream
-				io_manager::write_to_file(fd, buf, capacity * sizeof_tuple);
-				close(fd);
+				std::memcpy(seg->buf + pos * sizeof_tuple, tuples, n * sizeof_tuple);
+				commit(seg, n);
 
-//				Logger::print_thread_info_locked("flushed buffer[" + std::to_string(i) + "] to file " + file_name_str + "\n");
+				tuples += n * sizeof_tuple;
+				num_tuples -= n;
+			}
+		}
 
-				count = 0;
-				index = 0;
-				not_full.notify_all();
+		// write out one sealed segment, if any; the buffer lock is not held during the disk write
+		void flush(std::string& file_name_str, const int i) {
+			std::unique_lock<std::mutex> write_lock(write_mutex);
+
+			segment * seg = nullptr;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				if(sealed_segments.empty())
+					return;
+				seg = sealed_segments.front();
+				sealed_segments.pop_front();
 			}
 
-//			//for debugging
-//			if(is_full()){
-//			}
-//			else{
-////				Printer::print_thread_info_locked("trying to flush buffer[" + std::to_string(i) + "] to file " + file_name_str + "\n");
-//			}
-		}
+			write_segment(file_name_str, seg->buf, capacity);
+//			Logger::print_thread_info_locked("flushed buffer[" + std::to_string(i) + "] to file " + file_name_str + "\n");
 
-//		void flush_end(const char * file_name, const int i) {
-//			std::unique_lock<std::mutex> lock(mutex);
-////			if(!is_empty()){
-//				int perms = O_WRONLY | O_APPEND;
-//				int fd = open(file_name, perms, S_IRWXU);
-//				if(fd < 0){
-//					fd = creat(file_name, S_IRWXU);
-//				}
-//
-//				// flush buffer to update out stream
-//				io_manager::write_to_file(fd, buf, count * sizeof_tuple);
-//				close(fd);
-////			}
-//
-//		}
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				free_segments.push_back(seg);
+			}
+			not_full.notify_all();
+		}
 
+		// called once all producers are done: write the sealed segments left and the partial active one
 		void flush_end(std::string& file_name_str, const int i) {
+			std::unique_lock<std::mutex> write_lock(write_mutex);
 			std::unique_lock<std::mutex> lock(mutex);
-//			if(!is_empty()){
-				const char* file_name = file_name_str.c_str();
-				int perms = O_WRONLY | O_APPEND;
-				int fd = open(file_name, perms, S_IRWXU);
-				if(fd < 0){
-					fd = creat(file_name, S_IRWXU);
-				}
 
-				// flush buffer to update out stream
-				io_manager::write_to_file(fd, buf, count * sizeof_tuple);
-				close(fd);
-//			}
+			while(!sealed_segments.empty()) {
+				segment * seg = sealed_segments.front();
+				sealed_segments.pop_front();
+				write_segment(file_name_str, seg->buf, capacity);
+				free_segments.push_back(seg);
+			}
+
+			segment * seg = active.load();
+			assert(seg->committed == std::min(seg->reserved.load(), capacity));
+			write_segment(file_name_str, seg->buf, seg->committed);
 
 				//for debugging
 //				Logger::print_thread_info_locked("flushed buffer[" + std::to_string(i) + "] to file " + file_name_str + "\n");
@@ -155,17 +160,69 @@ namespace RStream {
 		}
 
 		bool is_full() {
-			return count == capacity;
+			std::unique_lock<std::mutex> lock(mutex);
+			return !sealed_segments.empty();
 		}
 
 		bool is_empty() {
-			return count == 0;
+			std::unique_lock<std::mutex> lock(mutex);
+			return sealed_segments.empty() && active.load()->committed == 0;
 		}
 
 		inline size_t get_sizeoftuple(){
 			return sizeof_tuple;
 		}
 
+	private:
+		// reserve up to num slots in the active segment, waiting for a free segment if it's full
+		segment * reserve(size_t num, size_t& pos, size_t& n) {
+			while(true) {
+				size_t gen = generation.load();
+				segment * seg = active.load();
+				pos = seg->reserved.fetch_add(num);
+				if(pos < capacity) {
+					n = std::min(num, capacity - pos);
+					return seg;
+				}
+
+				// segment is being sealed, wait until the next one is activated
+				std::unique_lock<std::mutex> lock(mutex);
+				not_full.wait(lock, [&] {return generation.load() != gen;});
+			}
+		}
+
+		// the producer filling the last slot of a segment seals it, hands it to the writers and activates a free one
+		void commit(segment * seg, size_t n) {
+			if(seg->committed.fetch_add(n) + n != capacity)
+				return;
+
+			std::unique_lock<std::mutex> lock(mutex);
+			sealed_segments.push_back(seg);
+			ready_queue->push(id);
+			not_full.wait(lock, [&] {return !free_segments.empty();});
+
+			segment * next = free_segments.front();
+			free_segments.pop_front();
+			next->committed = 0;
+			next->reserved = 0;
+			active = next;
+			generation++;
+			lock.unlock();
+			not_full.notify_all();
+		}
+
+		void write_segment(std::string& file_name_str, char * seg_buf, size_t num_tuples) {
+			const char * file_name = file_name_str.c_str();
+			int perms = O_WRONLY | O_APPEND;
+			int fd = open(file_name, perms, S_IRWXU);
+			if(fd < 0){
+				fd = creat(file_name, S_IRWXU);
+			}
+			// flush buffer to update out stream
+			io_manager::write_to_file(fd, seg_buf, num_tuples * sizeof_tuple);
+			close(fd);
+		}
+
 	};
 
 	// global buffer for shuffling, accessing by multithreads
@@ -174,11 +231,14 @@ namespace RStream {
 	    size_t capacity;
 		T * buf;
 		size_t count;
+		int id;
+		blocking_queue<int> * ready_queue;
 		std::mutex mutex;
 		std::condition_variable not_full;
 
 	public:
-		global_buffer(size_t _capacity) : capacity{_capacity}, count(0) {
+		global_buffer(size_t _capacity, int _id = -1, blocking_queue<int> * _ready_queue = nullptr) :
+			capacity{_capacity}, count(0), id(_id), ready_queue(_ready_queue) {
 			buf = new T [capacity];
 		}
 
@@ -192,11 +252,29 @@ namespace RStream {
 
 			// insert item to buffer
 			buf[count++] = *item;
+			notify_if_full();
 
 //			debugging info
 //			print_thread_info_locked("inserting an item: " + item->toString() + " to buffer[" + std::to_string(index) + "]\n");
 		}
 
+		// insert a block of num_items items, taking the lock once per block
+		void insert_batch(T* items, size_t num_items) {
+			std::unique_lock<std::mutex> lock(mutex);
+
+			while(num_items > 0) {
+				not_full.wait(lock, [&] {return !is_full();});
+
+				size_t n = std::min(num_items, capacity - count);
+				std::copy(items, items + n, buf + count);
+				count += n;
+				notify_if_full();
+
+				items += n;
+				num_items -= n;
+			}
+		}
+
 //		void flush(const char * file_name, const int i) {
 //			std::unique_lock<std::mutex> lock(mutex);
 //
@@ -318,15 +396,117 @@ namespace RStream {
 		size_t get_capacity() {
 			return capacity;
 		}
+
+	private:
+		// tell the writers this buffer is ready to be flushed, called with the lock held
+		void notify_if_full() {
+			if(ready_queue && is_full())
+				ready_queue->push(id);
+		}
+	};
+
+	// thread-local staging block in front of one global_buffer_for_mining.
+	// a producer fills it without locking and publishes it to the global buffer in one batch.
+	class local_buffer_for_mining {
+		global_buffer_for_mining * global_buf;
+		size_t capacity;
+		size_t count;
+		size_t sizeof_tuple;
+		size_t index;
+		char * buf;
+
+	public:
+		local_buffer_for_mining(global_buffer_for_mining * _global_buf) :
+			global_buf(_global_buf), count(0), sizeof_tuple(_global_buf->get_sizeoftuple()), index(0) {
+			capacity = std::max((size_t)1, LOCAL_BUFFER_SIZE / sizeof_tuple);
+			buf = new char[sizeof_tuple * capacity];
+		}
+
+		~local_buffer_for_mining() {
+			assert(count == 0);
+			delete[] buf;
+		}
+
+		void insert(char * tuple) {
+			std::memcpy(buf + index, tuple, sizeof_tuple);
+			advance();
+		}
+
+		void insert(char * tuple, char* extra_element) {
+			std::memcpy(buf + index, tuple, sizeof_tuple - sizeof(Element_In_Tuple));
+			std::memcpy(buf + index + sizeof_tuple - sizeof(Element_In_Tuple), extra_element, sizeof(Element_In_Tuple));
+			advance();
+		}
+
+		void insert_simple(char * tuple, char* extra_element) {
+			std::memcpy(buf + index, tuple, sizeof_tuple - sizeof(Base_Element));
+			std::memcpy(buf + index + sizeof_tuple - sizeof(Base_Element), extra_element, sizeof(Base_Element));
+			advance();
+		}
+
+		void publish() {
+			if(count == 0)
+				return;
+
+			global_buf->insert_batch(buf, count);
+			count = 0;
+			index = 0;
+		}
+
+		inline size_t get_sizeoftuple(){
+			return sizeof_tuple;
+		}
+
+	private:
+		inline void advance() {
+			index += sizeof_tuple;
+			if(++count == capacity)
+				publish();
+		}
+	};
+
+	// thread-local staging block in front of one global_buffer<T>
+	template <typename T>
+	class local_buffer {
+		global_buffer<T> * global_buf;
+		size_t capacity;
+		size_t count;
+		T * buf;
+
+	public:
+		local_buffer(global_buffer<T> * _global_buf) : global_buf(_global_buf), count(0) {
+			capacity = std::max((size_t)1, LOCAL_BUFFER_SIZE / sizeof(T));
+			buf = new T [capacity];
+		}
+
+		~local_buffer() {
+			assert(count == 0);
+			delete[] buf;
+		}
+
+		void insert(T* item) {
+			buf[count++] = *item;
+			if(count == capacity)
+				publish();
+		}
+
+		void publish() {
+			if(count == 0)
+				return;
+
+			global_buf->insert_batch(buf, count);
+			count = 0;
+		}
 	};
 
 	class buffer_manager_for_mining {
 	public:
-		static global_buffer_for_mining ** get_global_buffers_for_mining(int num_partitions, int sizeof_tuple) {
+		// sealed segments are reported to the writers through ready_queue
+		static global_buffer_for_mining ** get_global_buffers_for_mining(int num_partitions, int sizeof_tuple, blocking_queue<int> * ready_queue) {
 			global_buffer_for_mining ** buffers = new global_buffer_for_mining * [num_partitions];
 
 			for(int i = 0; i < num_partitions; i++) {
-				buffers[i] = new global_buffer_for_mining(BUFFER_CAPACITY, sizeof_tuple);
+				buffers[i] = new global_buffer_for_mining(BUFFER_CAPACITY, sizeof_tuple, i, ready_queue);
 			}
 
 			return buffers;
@@ -339,6 +519,32 @@ namespace RStream {
 //			else
 //				return nullptr;
 		}
+
+		// staging buffers of one producer thread, one per global buffer
+		static local_buffer_for_mining ** get_local_buffers_for_mining(global_buffer_for_mining ** buffers, int num_partitions) {
+			local_buffer_for_mining ** local_buffers = new local_buffer_for_mining * [num_partitions];
+
+			for(int i = 0; i < num_partitions; i++) {
+				local_buffers[i] = new local_buffer_for_mining(buffers[i]);
+			}
+
+			return local_buffers;
+		}
+
+		static local_buffer_for_mining * get_local_buffer_for_mining(local_buffer_for_mining ** local_buffers, int num_partitions, int index) {
+			assert(index >= 0 && index < num_partitions);
+			return local_buffers[index];
+		}
+
+		// publish whatever is left in the staging buffers, must happen before the producer signs off
+		static void release_local_buffers_for_mining(local_buffer_for_mining ** local_buffers, int num_partitions) {
+			for(int i = 0; i < num_partitions; i++) {
+				local_buffers[i]->publish();
+				delete local_buffers[i];
+			}
+
+			delete[] local_buffers;
+		}
 	};
 
 	template <typename T>
@@ -346,12 +552,12 @@ namespace RStream {
 
 	public:
 
-		// global buffers for shuffling
-		static global_buffer<T> **  get_global_buffers(int num_partitions) {
+		// global buffers for shuffling; if ready_queue is given, full buffers are reported to it
+		static global_buffer<T> **  get_global_buffers(int num_partitions, blocking_queue<int> * ready_queue = nullptr) {
 			global_buffer<T> ** buffers = new global_buffer<T> * [num_partitions];
 
 			for(int i = 0; i < num_partitions; i++) {
-				buffers[i] = new global_buffer<T>(BUFFER_CAPACITY);
+				buffers[i] = new global_buffer<T>(BUFFER_CAPACITY, i, ready_queue);
 			}
 
 			return buffers;
@@ -366,6 +572,32 @@ namespace RStream {
 //				return nullptr;
 		}
 
+		// staging buffers of one producer thread, one per global buffer
+		static local_buffer<T> ** get_local_buffers(global_buffer<T> ** buffers, int num_partitions) {
+			local_buffer<T> ** local_buffers = new local_buffer<T> * [num_partitions];
+
+			for(int i = 0; i < num_partitions; i++) {
+				local_buffers[i] = new local_buffer<T>(buffers[i]);
+			}
+
+			return local_buffers;
+		}
+
+		static local_buffer<T>* get_local_buffer(local_buffer<T> ** local_buffers, int num_partitions, int index) {
+			assert(index >= 0 && index < num_partitions);
+			return local_buffers[index];
+		}
+
+		// publish whatever is left in the staging buffers, must happen before the producer signs off
+		static void release_local_buffers(local_buffer<T> ** local_buffers, int num_partitions) {
+			for(int i = 0; i < num_partitions; i++) {
+				local_buffers[i]->publish();
+				delete local_buffers[i];
+			}
+
+			delete[] local_buffers;
+		}
+
 	};
 }
 
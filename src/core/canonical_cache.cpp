@@ -0,0 +1,37 @@
+/*
+ * canonical_cache.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ */
+
+#include "canonical_cache.hpp"
+
+namespace RStream {
+
+		canonical_cache::canonical_cache() : hits(0), misses(0) {
+
+		}
+
+		const Canonical_Graph * canonical_cache::get_canonical_graph(Quick_Pattern & quick_pattern) {
+			shard & s = shards[quick_pattern.get_hash() % NUM_CANONICAL_CACHE_SHARDS];
+			{
+				std::unique_lock<std::mutex> lock(s.mutex);
+				auto it = s.map.find(quick_pattern);
+				if(it != s.map.end()) {
+					hits++;
+					return &it->second;
+				}
+			}
+			misses++;
+
+			// run bliss outside the lock; if another thread got there first, its entry is kept
+			Canonical_Graph* cg = Pattern::turn_canonical_graph(quick_pattern, false);
+
+			std::unique_lock<std::mutex> lock(s.mutex);
+			auto it = s.map.insert(std::make_pair(quick_pattern, *cg)).first;
+			delete cg;
+			return &it->second;
+		}
+
+}
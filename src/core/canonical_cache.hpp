@@ -0,0 +1,45 @@
+/*
+ * canonical_cache.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ */
+
+#ifndef CORE_CANONICAL_CACHE_HPP_
+#define CORE_CANONICAL_CACHE_HPP_
+
+#include "pattern.hpp"
+#include "constants.hpp"
+
+namespace RStream {
+
+	// memoizes the canonical graph of every quick pattern, so bliss runs once per distinct
+	// quick pattern for the whole process instead of once per aggregation task.
+	// entries are never evicted, so the returned pointers stay valid.
+	class canonical_cache {
+		struct shard {
+			std::mutex mutex;
+			std::unordered_map<Quick_Pattern, Canonical_Graph> map;
+		};
+
+		shard shards[NUM_CANONICAL_CACHE_SHARDS];
+		std::atomic<long> hits;
+		std::atomic<long> misses;
+
+	public:
+		canonical_cache();
+
+		const Canonical_Graph * get_canonical_graph(Quick_Pattern & quick_pattern);
+
+		inline long get_hits() const {
+			return hits;
+		}
+
+		inline long get_misses() const {
+			return misses;
+		}
+	};
+
+}
+
+#endif /* CORE_CANONICAL_CACHE_HPP_ */
@@ -0,0 +1,134 @@
+/*
+ * canonical_table.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ */
+
+#include "canonical_table.hpp"
+
+namespace RStream {
+
+		const canonical_table & canonical_table::get_instance() {
+			// built once, on first use
+			static const canonical_table table;
+			return table;
+		}
+
+		canonical_table::canonical_table() {
+			for(unsigned int n = 1; n <= MAX_VERTICES; n++) {
+				build(n);
+			}
+		}
+
+		void canonical_table::build(unsigned int num_vertices) {
+			const unsigned int num_masks = 1u << (num_vertices * (num_vertices - 1) / 2);
+			entries[num_vertices].resize(num_masks);
+
+			std::vector<std::vector<BYTE>> all_perms;
+			std::vector<BYTE> perm(num_vertices);
+			for(unsigned int v = 0; v < num_vertices; v++)
+				perm[v] = v;
+			do {
+				all_perms.push_back(perm);
+			} while(std::next_permutation(perm.begin(), perm.end()));
+
+			for(unsigned int mask = 0; mask < num_masks; mask++) {
+				entry & e = entries[num_vertices][mask];
+				e.canonical_mask = UINT_MAX;
+				e.first_perm = perms.size() / MAX_VERTICES;
+				e.num_perms = 0;
+
+				for(auto it = all_perms.begin(); it != all_perms.end(); ++it) {
+					unsigned int permuted = permute_mask(mask, it->data(), num_vertices);
+					if(permuted < e.canonical_mask) {
+						e.canonical_mask = permuted;
+						e.num_perms = 0;
+						perms.resize(e.first_perm * MAX_VERTICES);
+					}
+					if(permuted == e.canonical_mask) {
+						perms.insert(perms.end(), it->begin(), it->end());
+						perms.resize(perms.size() + MAX_VERTICES - num_vertices, 0);
+						e.num_perms++;
+					}
+				}
+			}
+		}
+
+		unsigned int canonical_table::permute_mask(unsigned int mask, const BYTE * perm, unsigned int num_vertices) {
+			unsigned int permuted = 0;
+			for(unsigned int j = 1; j < num_vertices; j++) {
+				for(unsigned int i = 0; i < j; i++) {
+					if(mask & (1u << edge_bit(i, j)))
+						permuted |= 1u << edge_bit(perm[i], perm[j]);
+				}
+			}
+			return permuted;
+		}
+
+		unsigned int canonical_table::get_num_vertices(const Quick_Pattern & sub_graph) {
+			VertexId num_vertices = 0;
+			for(unsigned int index = 0; index < sub_graph.get_size(); ++index) {
+				num_vertices = std::max(num_vertices, sub_graph.at(index).vertex_id);
+			}
+			return num_vertices;
+		}
+
+		Canonical_Graph* canonical_table::turn_canonical_graph(const Quick_Pattern & sub_graph) const {
+			const unsigned int num_vertices = get_num_vertices(sub_graph);
+			assert(num_vertices >= 1 && num_vertices <= MAX_VERTICES);
+
+			// read labels and edges the way Pattern::readGraph does
+			BYTE labels[MAX_VERTICES];
+			for(unsigned int index = 0; index < sub_graph.get_size(); ++index) {
+				const Element_In_Tuple & element = sub_graph.at(index);
+				labels[element.vertex_id - 1] = element.vertex_label;
+			}
+
+			unsigned int mask = 0;
+			assert(sub_graph.get_size() > 1);
+			for(unsigned int index = 1; index < sub_graph.get_size(); ++index) {
+				const Element_In_Tuple & element = sub_graph.at(index);
+				VertexId from = sub_graph.at(element.history_info).vertex_id;
+				VertexId to = element.vertex_id;
+				assert(from != to);
+				mask |= 1u << edge_bit(from - 1, to - 1);
+			}
+
+			// among the relabelings giving the canonical structure, take the smallest label sequence
+			const entry & e = entries[num_vertices][mask];
+			BYTE best_labels[MAX_VERTICES], permuted_labels[MAX_VERTICES];
+			for(unsigned int p = 0; p < e.num_perms; p++) {
+				const BYTE * perm = &perms[(e.first_perm + p) * MAX_VERTICES];
+				for(unsigned int v = 0; v < num_vertices; v++) {
+					permuted_labels[perm[v]] = labels[v];
+				}
+				if(p == 0 || std::memcmp(permuted_labels, best_labels, num_vertices) < 0) {
+					std::memcpy(best_labels, permuted_labels, num_vertices);
+				}
+			}
+
+			// canonical graph, with sorted adjacency lists and the same hash bliss would give it
+			std::vector<bliss::Graph::Vertex> vertices(num_vertices);
+			bliss::UintSeqHash h;
+			h.update(num_vertices);
+			for(unsigned int v = 0; v < num_vertices; v++) {
+				vertices[v].color = best_labels[v];
+				h.update(vertices[v].color);
+			}
+			for(unsigned int i = 0; i < num_vertices; i++) {
+				for(unsigned int j = 0; j < num_vertices; j++) {
+					if(i != j && (e.canonical_mask & (1u << edge_bit(i, j)))) {
+						vertices[i].add_edge(j);
+						if(j > i) {
+							h.update(i);
+							h.update(j);
+						}
+					}
+				}
+			}
+
+			return new Canonical_Graph(vertices, h.get_value());
+		}
+
+}
@@ -0,0 +1,65 @@
+/*
+ * canonical_table.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ */
+
+#ifndef CORE_CANONICAL_TABLE_HPP_
+#define CORE_CANONICAL_TABLE_HPP_
+
+#include "../struct/quick_pattern.hpp"
+#include "../struct/canonical_graph.hpp"
+
+namespace RStream {
+
+	// canonical labeling of small undirected patterns without bliss.
+	// for every vertex count up to MAX_VERTICES and every adjacency bitmask, the table keeps the
+	// smallest bitmask reachable by relabeling, and all the relabelings reaching it.
+	// a labeled pattern is then canonical under the one of those relabelings giving the smallest label sequence.
+	class canonical_table {
+	public:
+		static const unsigned int MAX_VERTICES = 5;
+
+		static const canonical_table & get_instance();
+
+		// number of vertices of a quick pattern, whose ids are 1..n
+		static unsigned int get_num_vertices(const Quick_Pattern & sub_graph);
+
+		// sub_graph must have at most MAX_VERTICES vertices
+		Canonical_Graph* turn_canonical_graph(const Quick_Pattern & sub_graph) const;
+
+	private:
+		static const unsigned int MAX_PAIRS = MAX_VERTICES * (MAX_VERTICES - 1) / 2;
+
+		struct entry {
+			unsigned int canonical_mask;
+			unsigned int first_perm;
+			unsigned int num_perms;
+		};
+
+		// entries[n][mask]
+		std::vector<entry> entries[MAX_VERTICES + 1];
+		// relabelings, MAX_VERTICES per perm: perms[p * MAX_VERTICES + v] is the new id of vertex v
+		std::vector<BYTE> perms;
+
+		canonical_table();
+
+		void build(unsigned int num_vertices);
+
+		// bit of the undirected edge (i, j), the same for every vertex count
+		static inline unsigned int edge_bit(unsigned int i, unsigned int j) {
+			if(i > j) {
+				unsigned int tmp = i;
+				i = j;
+				j = tmp;
+			}
+			return j * (j - 1) / 2 + i;
+		}
+
+		static unsigned int permute_mask(unsigned int mask, const BYTE * perm, unsigned int num_vertices);
+	};
+
+}
+
+#endif /* CORE_CANONICAL_TABLE_HPP_ */
@@ -50,6 +50,53 @@ namespace RStream {
 
 		int size() { return queue.size();}
 	};
+
+	// queue that writer threads block on; pop returns false once the queue is closed and drained
+	template <typename T>
+	class blocking_queue {
+		std::queue<T> queue;
+		bool closed;
+		std::mutex mutex;
+		std::condition_variable not_empty;
+
+	public:
+		blocking_queue() : closed(false) {}
+
+		void push(const T & item) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				queue.push(item);
+			}
+			not_empty.notify_one();
+		}
+
+		bool pop(T& item) {
+			std::unique_lock<std::mutex> lock(mutex);
+			not_empty.wait(lock, [&] {return !queue.empty() || closed;});
+			if(queue.empty()){
+				return false;
+			}
+
+			item = queue.front();
+			queue.pop();
+			return true;
+		}
+
+		// no more items will be pushed, wake up all waiting threads
+		void close() {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				closed = true;
+			}
+			not_empty.notify_all();
+		}
+
+		void reset() {
+			std::unique_lock<std::mutex> lock(mutex);
+			std::queue<T>().swap(queue);
+			closed = false;
+		}
+	};
 }
 
 
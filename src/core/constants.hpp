@@ -11,10 +11,19 @@
 namespace RStream{
 
 const size_t BUFFER_CAPACITY = 1000000;
+const int NUM_BUFFER_SEGMENTS = 2; // segments per shuffle buffer, one fills while another is flushed
+const size_t LOCAL_BUFFER_SIZE = 64 * 1024; // per-thread staging block for each partition
 const long IO_SIZE = 16 * 1024 * 1024; // 24M
 const long CHUNK_SIZE = IO_SIZE * 2;
 const long PAGE_SIZE = 4 * 1024; // 4K
 const int MAX_QUEUE_SIZE = 65536;
+const int NUM_IO_THREADS = 4;
+const int NUM_CANONICAL_CACHE_SHARDS = 64; // lock shards of the quick pattern -> canonical graph cache
+const long SORT_MEMORY_BUDGET = 256 * 1024 * 1024; // per exec thread, for the sorted runs of RPhase remove_dup, set_difference and sort-merge join, 256M
+const long JOIN_MEMORY_BUDGET = 256 * 1024 * 1024; // per exec thread, RPhase sort-merge joins partitions whose edge hashmap would exceed it, 256M
+const long TRIANGLE_MEMORY_BUDGET = 4L * 1024 * 1024 * 1024; // oriented partitions triangle counting keeps in memory at once, 4G
+const long MAX_ROUTING_BLOCKS = 16 * 1024 * 1024; // entries of the vertex id -> partition table of partition_router, 64M
+const long PREPROCESSING_MEMORY_BUDGET = 2L * 1024 * 1024 * 1024; // text the preprocessor keeps parsed in memory before its edges are written, 2G
 
 }
 #endif /* CORE_CONSTANTS_HPP_ */
@@ -0,0 +1,232 @@
+/*
+ * edge_index.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ */
+
+#include "edge_index.hpp"
+#include "concurrent_queue.hpp"
+
+#include <sys/mman.h>
+
+namespace RStream {
+
+		edge_index::edge_index() : loaded(false), num_vertices(0), num_edges(0), num_distinct_edges(0), offsets(nullptr), neighbors(nullptr), labels(nullptr), mapped(nullptr), mapped_size(0) {
+
+		}
+
+		edge_index::~edge_index() {
+			if(mapped) {
+				munmap(mapped, mapped_size);
+				return;
+			}
+
+			delete[] offsets;
+			delete[] neighbors;
+			delete[] labels;
+		}
+
+		void edge_index::load(const std::string & filename, const std::vector<std::pair<VertexId, VertexId>> & vertex_intervals, int edge_unit, int num_threads) {
+			std::unique_lock<std::mutex> lock(mutex);
+			if(loaded)
+				return;
+
+			// vertex ids are indexed directly, so the index spans [0, last vertex]
+			num_vertices = vertex_intervals.back().second + 1;
+			const std::string file_name = get_file_name(filename);
+			if(!read_from_disk(file_name)) {
+				build(filename, vertex_intervals, edge_unit, num_threads);
+				write_to_disk(file_name);
+
+				// serve the fresh index from its file too, so pages nobody touches can be dropped.
+				// the heap copy is only freed once the mapping is in place, and keeps serving otherwise
+				long * heap_offsets = offsets;
+				VertexId * heap_neighbors = neighbors;
+				BYTE * heap_labels = labels;
+				if(read_from_disk(file_name)) {
+					delete[] heap_offsets;
+					delete[] heap_neighbors;
+					delete[] heap_labels;
+				}
+			}
+
+			loaded = true;
+		}
+
+		// partitions own disjoint, contiguous source intervals, so each pass runs one partition per task
+		// and every thread writes to its own slice of offsets / neighbors / labels only
+		void edge_index::build(const std::string & filename, const std::vector<std::pair<VertexId, VertexId>> & vertex_intervals, int edge_unit, int num_threads) {
+			// Edge, WeightedEdge and LabeledEdge all start with src and target, only LabeledEdge has labels
+			assert(edge_unit >= (int)sizeof(Edge));
+			const bool labeled = edge_unit == sizeof(LabeledEdge);
+			const int num_partitions = vertex_intervals.size();
+			for(int partition_id = 1; partition_id < num_partitions; partition_id++) {
+				assert(vertex_intervals[partition_id].first == vertex_intervals[partition_id - 1].second + 1);
+			}
+
+			offsets = new long[num_vertices + 1]();
+			std::vector<char*> edge_bufs(num_partitions);
+			std::vector<long> edge_file_sizes(num_partitions);
+
+			// first pass: load each partition and count the out degree of its vertices
+			run_per_partition(num_partitions, num_threads, [&](int partition_id) {
+				int fd_edge = open((filename + "." + std::to_string(partition_id)).c_str(), O_RDONLY);
+				assert(fd_edge > 0);
+				long edge_file_size = io_manager::get_filesize(fd_edge);
+
+				// edges are fully loaded into memory
+				char * edge_local_buf = (char *)malloc(edge_file_size);
+				io_manager::read_from_file(fd_edge, edge_local_buf, edge_file_size, 0);
+				close(fd_edge);
+
+				for(long pos = 0; pos < edge_file_size; pos += edge_unit) {
+					LabeledEdge * e = (LabeledEdge*)(edge_local_buf + pos);
+					assert(e->src >= vertex_intervals[partition_id].first && e->src <= vertex_intervals[partition_id].second);
+					offsets[e->src + 1]++;
+				}
+
+				edge_bufs[partition_id] = edge_local_buf;
+				edge_file_sizes[partition_id] = edge_file_size;
+			});
+
+			// the edges of partition p start right after the edges of partitions [0, p)
+			std::vector<long> partition_base(num_partitions + 1, 0);
+			for(int partition_id = 0; partition_id < num_partitions; partition_id++) {
+				partition_base[partition_id + 1] = partition_base[partition_id] + edge_file_sizes[partition_id] / edge_unit;
+			}
+			num_edges = partition_base[num_partitions];
+
+			neighbors = new VertexId[num_edges];
+			labels = new BYTE[num_edges];
+			std::vector<long> num_distinct(num_partitions);
+
+			// second pass: prefix-sum the degrees within the interval, then place every edge at its vertex's cursor, keeping the file order
+			run_per_partition(num_partitions, num_threads, [&](int partition_id) {
+				const VertexId first = vertex_intervals[partition_id].first, last = vertex_intervals[partition_id].second;
+				long sum = partition_base[partition_id];
+				for(long v = first; v <= last; v++) {
+					sum += offsets[v + 1];
+					offsets[v + 1] = sum;
+				}
+
+				// offsets[first] is written by the previous partition, its value is our base
+				std::vector<long> cursors(last - first + 1);
+				cursors[0] = partition_base[partition_id];
+				for(long v = first + 1; v <= last; v++)
+					cursors[v - first] = offsets[v];
+				char * edge_local_buf = edge_bufs[partition_id];
+				for(long pos = 0; pos < edge_file_sizes[partition_id]; pos += edge_unit) {
+					LabeledEdge * e = (LabeledEdge*)(edge_local_buf + pos);
+					long k = cursors[e->src - first]++;
+					neighbors[k] = e->target;
+					labels[k] = labeled ? e->target_label : 0;
+				}
+
+				free(edge_local_buf);
+
+				// sort every neighbor range, with its labels, so ranges can be merged and intersected directly.
+				// parallel edges stay, next to each other, and the distinct neighbors are counted
+				std::vector<std::pair<VertexId, BYTE>> range;
+				long distinct = 0;
+				for(long v = first; v <= last; v++) {
+					long range_begin = (v == first) ? partition_base[partition_id] : offsets[v];
+					long range_end = offsets[v + 1];
+					if(!std::is_sorted(neighbors + range_begin, neighbors + range_end)) {
+						range.clear();
+						for(long k = range_begin; k < range_end; k++)
+							range.push_back(std::make_pair(neighbors[k], labels[k]));
+						std::sort(range.begin(), range.end());
+						for(long k = range_begin; k < range_end; k++) {
+							neighbors[k] = range[k - range_begin].first;
+							labels[k] = range[k - range_begin].second;
+						}
+					}
+
+					for(long k = range_begin; k < range_end; k++) {
+						if(k == range_begin || neighbors[k] != neighbors[k - 1])
+							distinct++;
+					}
+				}
+				num_distinct[partition_id] = distinct;
+			});
+
+			num_distinct_edges = 0;
+			for(int partition_id = 0; partition_id < num_partitions; partition_id++)
+				num_distinct_edges += num_distinct[partition_id];
+		}
+
+		void edge_index::run_per_partition(int num_partitions, int num_threads, std::function<void(int)> work) {
+			concurrent_queue<int> task_queue;
+			for(int partition_id = 0; partition_id < num_partitions; partition_id++)
+				task_queue.push(partition_id);
+
+			std::vector<std::thread> threads;
+			for(int i = 0; i < std::min(num_threads, num_partitions); i++) {
+				threads.push_back(std::thread([&] {
+					int partition_id = -1;
+					while(task_queue.test_pop_atomic(partition_id))
+						work(partition_id);
+				}));
+			}
+
+			for(auto &t : threads)
+				t.join();
+		}
+
+		bool edge_index::read_from_disk(const std::string & file_name) {
+			int fd = open(file_name.c_str(), O_RDONLY);
+			if(fd < 0)
+				return false;
+
+			// header: format version, number of vertices, edges and distinct edges
+			long header[4];
+			long file_size = io_manager::get_filesize(fd);
+			if(file_size < (long)sizeof(header)) {
+				close(fd);
+				return false;
+			}
+			io_manager::read_from_file(fd, (char*)header, sizeof(header), 0);
+
+			long expected_size = sizeof(header) + (header[1] + 1) * sizeof(long) + header[2] * (sizeof(VertexId) + sizeof(BYTE));
+			if(header[0] != FORMAT_VERSION || header[1] != num_vertices || file_size != expected_size) {
+				close(fd);
+				return false;
+			}
+
+			// the index is mapped read-only rather than copied: every join and iteration of the process shares the page cache,
+			// and only the pages of the vertices actually joined are ever read
+			void * map = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+			close(fd);
+			if(map == MAP_FAILED)
+				return false;
+
+			mapped = (char*)map;
+			mapped_size = file_size;
+			num_edges = header[2];
+			num_distinct_edges = header[3];
+
+			size_t offset = sizeof(header);
+			offsets = (long*)(mapped + offset);
+			offset += (num_vertices + 1) * sizeof(long);
+			neighbors = (VertexId*)(mapped + offset);
+			offset += num_edges * sizeof(VertexId);
+			labels = (BYTE*)(mapped + offset);
+
+			return true;
+		}
+
+		void edge_index::write_to_disk(const std::string & file_name) {
+			int fd = open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
+			assert(fd > 0);
+
+			long header[4] = {FORMAT_VERSION, num_vertices, num_edges, num_distinct_edges};
+			io_manager::write_to_file(fd, (char*)header, sizeof(header));
+			io_manager::append_to_file(fd, (char*)offsets, (num_vertices + 1) * sizeof(long));
+			io_manager::append_to_file(fd, (char*)neighbors, num_edges * sizeof(VertexId));
+			io_manager::append_to_file(fd, (char*)labels, num_edges * sizeof(BYTE));
+
+			close(fd);
+		}
+
+}
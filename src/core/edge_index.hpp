@@ -0,0 +1,93 @@
+/*
+ * edge_index.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ */
+
+#ifndef CORE_EDGE_INDEX_HPP_
+#define CORE_EDGE_INDEX_HPP_
+
+#include "../common/RStreamCommon.hpp"
+#include "../struct/type.hpp"
+#include "io_manager.hpp"
+
+namespace RStream {
+
+	// compact CSR over the edge partitions, shared by all the mining and relational joins.
+	// neighbors of v are neighbors[offsets[v] .. offsets[v + 1]), sorted by id, with every parallel edge kept
+	// like the partitions have it, labels[k] is the label of neighbors[k] (0 for unlabeled edges).
+	// once built it is persisted, and served read-only from a memory mapping of that file.
+	class edge_index {
+		// bumped whenever the layout of the persisted index changes, older files are rebuilt
+		static const long FORMAT_VERSION = 4;
+
+		std::mutex mutex;
+		bool loaded;
+
+		long num_vertices;
+		long num_edges;
+		long num_distinct_edges;
+		long * offsets;
+		VertexId * neighbors;
+		BYTE * labels;
+
+		char * mapped;
+		long mapped_size;
+
+	public:
+		edge_index();
+		~edge_index();
+
+		// only the first call does the work: load the persisted index, or build it from the partitions and persist it
+		void load(const std::string & filename, const std::vector<std::pair<VertexId, VertexId>> & vertex_intervals, int edge_unit, int num_threads);
+
+		inline long begin(VertexId v) const {
+			return offsets[v];
+		}
+
+		inline long end(VertexId v) const {
+			return offsets[v + 1];
+		}
+
+		inline VertexId neighbor(long k) const {
+			return neighbors[k];
+		}
+
+		inline BYTE label(long k) const {
+			return labels[k];
+		}
+
+		inline long get_num_edges() const {
+			return num_edges;
+		}
+
+		// sorted neighbor range of v, e.g. for intersection once it is known to be distinct
+		// (see has_parallel_edges)
+		inline const VertexId * get_neighbors(VertexId v) const {
+			return neighbors + offsets[v];
+		}
+
+		// some neighbor range repeats an id, so ranges must be deduplicated before they are intersected
+		inline bool has_parallel_edges() const {
+			return num_distinct_edges != num_edges;
+		}
+
+		inline long get_degree(VertexId v) const {
+			return offsets[v + 1] - offsets[v];
+		}
+
+		static std::string get_file_name(const std::string & filename) {
+			return filename + ".csr";
+		}
+
+	private:
+		void build(const std::string & filename, const std::vector<std::pair<VertexId, VertexId>> & vertex_intervals, int edge_unit, int num_threads);
+		void run_per_partition(int num_partitions, int num_threads, std::function<void(int)> work);
+		bool read_from_disk(const std::string & file_name);
+		void write_to_disk(const std::string & file_name);
+	};
+
+}
+
+#endif /* CORE_EDGE_INDEX_HPP_ */
@@ -18,7 +18,7 @@ namespace RStream {
 		unsigned Engine::tuple_long = 0;
 		unsigned Engine::tuple_filter = 0;
 
-		Engine::Engine(std::string _filename, int num_parts, int input_format) : filename(_filename) {
+		Engine::Engine(std::string _filename, int num_parts, int input_format, PartitionType partition_type, VertexOrder vertex_order) : filename(_filename) {
 //			num_threads = std::thread::hardware_concurrency();
 			num_threads = 16;
 			num_write_threads = 1;
@@ -35,11 +35,27 @@ namespace RStream {
 			if(!file_exists(meta_file)) {
 //				Preproc proc(_filename, num_vertices, num_partitions, false, false);
 //				Preprocessing proc(_filename, num_partitions, num_vertices);
-				Preprocessing_new proc(filename, num_parts, input_format);
+				// a vertex order of an earlier run would relabel this one
+				if(file_exists(Preprocessing_new::get_order_file(filename)))
+					FileUtil::delete_file(Preprocessing_new::get_order_file(filename));
+
+				Preprocessing_new proc(filename, num_parts, input_format, partition_type, vertex_order);
+
+				// the persisted edge index and the sorted copies belong to the old partitions
+				if(file_exists(edge_index::get_file_name(filename)))
+					FileUtil::delete_file(edge_index::get_file_name(filename));
+				for(int i = 0; i < num_parts; i++) {
+					if(file_exists(get_sorted_edge_file(filename, i)))
+						FileUtil::delete_file(get_sorted_edge_file(filename, i));
+				}
 			}
 
 			// get meta data from .meta file
 			read_meta_file(meta_file);
+			router.build(vertex_intervals);
+			read_order_file(Preprocessing_new::get_order_file(filename));
+
+			edges = std::make_shared<edge_index>();
 
 //			edge_type = static_cast<EdgeType>(proc.getEdgeType());
 //			edge_unit = proc.getEdgeUnit();
@@ -72,10 +88,45 @@ namespace RStream {
 			//delete .meta
 			FileUtil::delete_file(filename + ".meta");
 
-			//delete partitions
+			//delete partitions, and their sorted copies
 			for(int i = 0; i < num_partitions; ++i){
 				FileUtil::delete_file(filename + "." + std::to_string(i));
+				if(file_exists(get_sorted_edge_file(filename, i)))
+					FileUtil::delete_file(get_sorted_edge_file(filename, i));
 			}
+
+			//delete vertex order
+			if(file_exists(Preprocessing_new::get_order_file(filename)))
+				FileUtil::delete_file(Preprocessing_new::get_order_file(filename));
+
+			//delete edge index
+			if(file_exists(edge_index::get_file_name(filename)))
+				FileUtil::delete_file(edge_index::get_file_name(filename));
+		}
+
+		PartitionType Engine::parse_partition_type(const char * name) {
+			if(!name || std::string(name) == "vertices")
+				return PartitionType::OnVertices;
+			if(std::string(name) == "edges")
+				return PartitionType::OnEdges;
+
+			fprintf(stderr, "unknown partitioning %s, expected vertices or edges\n", name);
+			exit(-1);
+		}
+
+		VertexOrder Engine::parse_vertex_order(const char * name) {
+			if(!name || std::string(name) == "original")
+				return VertexOrder::Original;
+			if(std::string(name) == "degree")
+				return VertexOrder::DegreeSorted;
+
+			fprintf(stderr, "unknown vertex order %s, expected original or degree\n", name);
+			exit(-1);
+		}
+
+		const edge_index & Engine::get_edge_index() const {
+			edges->load(filename, vertex_intervals, edge_unit, num_threads);
+			return *edges;
 		}
 
 //		void preprocess(){
@@ -323,6 +374,20 @@ namespace RStream {
 			fclose(fd);
 		}
 
+		void Engine::read_order_file(const std::string & filename) {
+			if(!file_exists(filename))
+				return;
+
+			int fd = open(filename.c_str(), O_RDONLY);
+			assert(fd > 0);
+			long file_size = io_manager::get_filesize(fd);
+			assert(file_size == (long)num_vertices * (long)sizeof(VertexId));
+
+			original_ids.resize(num_vertices);
+			io_manager::read_from_file(fd, (char*)original_ids.data(), file_size, 0);
+			close(fd);
+		}
+
 
 }
 
@@ -10,6 +10,9 @@
 
 
 #include "concurrent_queue.hpp"
+#include "edge_index.hpp"
+#include "partition_router.hpp"
+#include "vertex_view.hpp"
 #include "../struct/type.hpp"
 #include "../utility/FileUtil.hpp"
 
@@ -41,6 +44,10 @@ namespace RStream {
 
 //		int* vertex_intervals;
 		std::vector<std::pair<VertexId, VertexId>> vertex_intervals;
+		// partition of a vertex id, see meta_info::get_index
+		partition_router router;
+		// input id of every vertex id if the preprocessor reordered the vertices, empty otherwise
+		std::vector<VertexId> original_ids;
 
 		static unsigned update_count;
 		static unsigned aggregation_count;
@@ -51,13 +58,31 @@ namespace RStream {
 		static unsigned tuple_long;
 		static unsigned tuple_filter;
 
-		Engine(std::string _filename, int num_parts, int input_format);
+		Engine(std::string _filename, int num_parts, int input_format, PartitionType partition_type = PartitionType::OnVertices, VertexOrder vertex_order = VertexOrder::Original);
 
 		~Engine();
 
+		// preprocessing options as named on the command line of the apps: "vertices" (equal id ranges) or "edges"
+		// (edge balanced), and "original" or "degree" (relabeled by decreasing degree). a missing name is the default
+		static PartitionType parse_partition_type(const char * name);
+		static VertexOrder parse_vertex_order(const char * name);
+
 		//clean files added by Zhiqiang
 		void clean_files();
 
+		// the id a vertex has in the input graph, to report results in
+		VertexId get_original_id(VertexId id) const {
+			return original_ids.empty() ? id : original_ids[id];
+		}
+
+		// CSR over the edge partitions, built (or loaded from disk) on first use and shared by all copies of the engine
+		const edge_index & get_edge_index() const;
+
+		// copy of an edge partition sorted on src, written by the sort-merge join of RPhase if the partition is not sorted
+		static std::string get_sorted_edge_file(const std::string & filename, int partition_id) {
+			return filename + "." + std::to_string(partition_id) + ".sorted";
+		}
+
 
 		/* init vertex data*/
 		template <typename VertexDataType>
@@ -163,14 +188,6 @@ namespace RStream {
 			}
 		}
 
-		template <typename VertexDataType>
-		void load_vertices_hashMap(char* vertex_local_buf, const int vertex_file_size, std::unordered_map<VertexId, VertexDataType*> & vertex_map) {
-			for(size_t off = 0; off < vertex_file_size; off += vertex_unit){
-				VertexDataType* v = reinterpret_cast<VertexDataType*>(vertex_local_buf + off);
-				vertex_map[v->id] = v;
-			}
-		}
-
 		template <typename VertexDataType>
 		void compute_degree_producer(concurrent_queue<int> * task_queue) {
 
@@ -187,8 +204,7 @@ namespace RStream {
 				// vertex data fully loaded into memory
 				char * vertex_local_buf = new char[vertex_file_size];
 				io_manager::read_from_file(fd_vertex, vertex_local_buf, vertex_file_size, 0);
-				std::unordered_map<VertexId, VertexDataType*> vertex_map;
-				load_vertices_hashMap(vertex_local_buf, vertex_file_size, vertex_map);
+				vertex_view<VertexDataType> vertices(vertex_local_buf, vertex_file_size, vertex_intervals[partition_id].first);
 
 				// streaming edges
 //				char * edge_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
@@ -220,9 +236,7 @@ namespace RStream {
 					for(long pos = 0; pos < valid_io_size; pos += edge_unit) {
 						// get an edge
 						Edge * e = (Edge*)(edge_local_buf + pos);
-						assert(vertex_map.find(e->src) != vertex_map.end());
-						VertexDataType * src_vertex = vertex_map.find(e->src)->second;
-						src_vertex->degree++;
+						vertices.get(e->src)->degree++;
 					}
 
 				}
@@ -245,12 +259,15 @@ namespace RStream {
 			}
 		}
 
+		std::shared_ptr<edge_index> edges;
+
 		inline bool file_exists(const std::string  filename) {
 			struct stat buffer;
 			return (stat(filename.c_str(), &buffer) == 0);
 		}
 
 		void read_meta_file(const std::string & filename);
+		void read_order_file(const std::string & filename);
 
 		// Removes \n from the end of line
 		inline void FIXLINE(char * s) {
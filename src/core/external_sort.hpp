@@ -0,0 +1,333 @@
+/*
+ * external_sort.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ */
+
+#ifndef CORE_EXTERNAL_SORT_HPP_
+#define CORE_EXTERNAL_SORT_HPP_
+
+#include "io_manager.hpp"
+#include "../utility/FileUtil.hpp"
+
+namespace RStream {
+
+	// records are ordered by their raw bytes, the first byte being the most significant.
+	// that is all the set operators need, since equal records end up adjacent,
+	// but it requires records without padding, as updates are.
+	template<typename T>
+	inline bool record_less(const T & a, const T & b) {
+		return std::memcmp(&a, &b, sizeof(T)) < 0;
+	}
+
+	template<typename T>
+	inline bool record_equal(const T & a, const T & b) {
+		return std::memcmp(&a, &b, sizeof(T)) == 0;
+	}
+
+	// lsd radix sort of records on their bytes, in the order of record_less. scratch must hold n records.
+	// all byte histograms come from one pass, and bytes every record shares (e.g. the high bytes of ids) cost no pass.
+	template<typename T>
+	void radix_sort(T * records, long n, T * scratch) {
+		if(n < 2)
+			return;
+
+		std::vector<long> counts(sizeof(T) * 256, 0);
+		for(long i = 0; i < n; i++) {
+			const unsigned char * bytes = reinterpret_cast<const unsigned char*>(records + i);
+			for(unsigned int b = 0; b < sizeof(T); b++)
+				counts[b * 256 + bytes[b]]++;
+		}
+
+		T * from = records, * to = scratch;
+		for(int b = sizeof(T) - 1; b >= 0; b--) {
+			long * count = counts.data() + b * 256;
+			if(count[reinterpret_cast<const unsigned char*>(from)[b]] == n)
+				continue;
+
+			long offset = 0;
+			for(int digit = 0; digit < 256; digit++) {
+				long c = count[digit];
+				count[digit] = offset;
+				offset += c;
+			}
+			for(long i = 0; i < n; i++)
+				to[count[reinterpret_cast<const unsigned char*>(from + i)[b]]++] = from[i];
+			std::swap(from, to);
+		}
+
+		if(from != records)
+			std::copy(from, from + n, records);
+	}
+
+	// stable lsd radix sort of records on the numeric value of the id Order::key picks from them
+	template<typename Order, typename T>
+	void radix_sort_by_key(T * records, long n, T * scratch) {
+		if(n < 2)
+			return;
+
+		std::vector<long> counts(sizeof(VertexId) * 256, 0);
+		for(long i = 0; i < n; i++) {
+			VertexId key = Order::key(records[i]);
+			for(unsigned int b = 0; b < sizeof(VertexId); b++)
+				counts[b * 256 + ((key >> (b * 8)) & 0xff)]++;
+		}
+
+		T * from = records, * to = scratch;
+		for(unsigned int b = 0; b < sizeof(VertexId); b++) {
+			long * count = counts.data() + b * 256;
+			if(count[(Order::key(from[0]) >> (b * 8)) & 0xff] == n)
+				continue;
+
+			long offset = 0;
+			for(int digit = 0; digit < 256; digit++) {
+				long c = count[digit];
+				count[digit] = offset;
+				offset += c;
+			}
+			for(long i = 0; i < n; i++)
+				to[count[(Order::key(from[i]) >> (b * 8)) & 0xff]++] = from[i];
+			std::swap(from, to);
+		}
+
+		if(from != records)
+			std::copy(from, from + n, records);
+	}
+
+	// orders of the records a sorted_stream hands out
+	template<typename T>
+	struct byte_order {
+		static inline bool less(const T & a, const T & b) {
+			return record_less(a, b);
+		}
+
+		static inline void sort(T * records, long n, T * scratch) {
+			radix_sort(records, n, scratch);
+		}
+	};
+
+	// updates on their target, the key they are joined on
+	template<typename T>
+	struct target_order {
+		static inline VertexId key(const T & record) {
+			return record.target;
+		}
+
+		static inline bool less(const T & a, const T & b) {
+			return a.target < b.target;
+		}
+
+		static inline void sort(T * records, long n, T * scratch) {
+			radix_sort_by_key<target_order<T>>(records, n, scratch);
+		}
+	};
+
+	// edges on their src
+	template<typename T>
+	struct src_order {
+		static inline VertexId key(const T & record) {
+			return record.src;
+		}
+
+		static inline bool less(const T & a, const T & b) {
+			return a.src < b.src;
+		}
+
+		static inline void sort(T * records, long n, T * scratch) {
+			radix_sort_by_key<src_order<T>>(records, n, scratch);
+		}
+	};
+
+	/* the records of a file, or of the range [offset, offset + size) of it, in the order Order, using at most about memory_budget bytes.
+	 * the range is cut into runs of memory_budget bytes that are radix sorted in memory. a single run is served
+	 * from memory, more runs are spilled next to the file and merged back while reading.
+	 */
+	template<typename T, typename Order = byte_order<T>>
+	class sorted_stream {
+		struct run {
+			int fd;
+			stream_reader * reader;
+			char * buf;
+			long valid_size;
+			long pos;
+		};
+
+		// heap of the head record of every run, smallest on top
+		struct greater_head {
+			bool operator()(const std::pair<T, int> & a, const std::pair<T, int> & b) const {
+				return Order::less(b.first, a.first);
+			}
+		};
+
+		std::string file_name;
+		long offset;
+		std::vector<T> records;
+		size_t next_record;
+
+		std::vector<run> runs;
+		std::priority_queue<std::pair<T, int>, std::vector<std::pair<T, int>>, greater_head> heads;
+
+	public:
+		sorted_stream(const std::string & _file_name, long memory_budget) : file_name(_file_name), offset(0), next_record(0) {
+			int fd = open(file_name.c_str(), O_RDONLY);
+			assert(fd > 0);
+			long file_size = io_manager::get_filesize(fd);
+			close(fd);
+
+			init(file_size, memory_budget);
+		}
+
+		sorted_stream(const std::string & _file_name, long _offset, long size, long memory_budget) : file_name(_file_name), offset(_offset), next_record(0) {
+			init(size, memory_budget);
+		}
+
+		~sorted_stream() {
+			for(unsigned int i = 0; i < runs.size(); i++) {
+				delete runs[i].reader;
+				close(runs[i].fd);
+				FileUtil::delete_file(get_run_file(i));
+			}
+		}
+
+		// the next record in sorted order, false once all have been handed out
+		inline bool next(T & record) {
+			if(runs.empty()) {
+				if(next_record == records.size())
+					return false;
+				record = records[next_record++];
+				return true;
+			}
+
+			if(heads.empty())
+				return false;
+
+			std::pair<T, int> head = heads.top();
+			heads.pop();
+			record = head.first;
+
+			T next_head;
+			if(read_run(head.second, next_head))
+				heads.push(std::make_pair(next_head, head.second));
+			return true;
+		}
+
+	private:
+		void init(long size, long memory_budget) {
+			assert(size % sizeof(T) == 0);
+			if(size == 0)
+				return;
+
+			int fd = open(file_name.c_str(), O_RDONLY);
+			assert(fd > 0);
+
+			// a run and its sorting scratch share the budget
+			long run_size = std::max(memory_budget / 2 / (long)sizeof(T), 1L) * sizeof(T);
+			std::vector<T> scratch;
+			std::vector<std::string> run_files;
+			for(long run_offset = 0; run_offset < size; run_offset += run_size) {
+				long size_of_run = std::min(run_size, size - run_offset);
+				records.resize(size_of_run / sizeof(T));
+				scratch.resize(records.size());
+				io_manager::read_from_file(fd, (char*)records.data(), size_of_run, offset + run_offset);
+				Order::sort(records.data(), records.size(), scratch.data());
+
+				// the whole range is one run, keep it
+				if(size_of_run == size)
+					break;
+
+				run_files.push_back(get_run_file(run_files.size()));
+				int fd_run = open(run_files.back().c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
+				assert(fd_run > 0);
+				io_manager::write_to_file(fd_run, (char*)records.data(), size_of_run);
+				close(fd_run);
+			}
+			close(fd);
+
+			if(run_files.empty())
+				return;
+
+			std::vector<T>().swap(records);
+			std::vector<T>().swap(scratch);
+
+			// every run is read through a double buffer, all of them together within the budget
+			long io_size = std::max(memory_budget / 2 / (long)run_files.size() / (long)sizeof(T), 1L) * sizeof(T);
+			for(unsigned int i = 0; i < run_files.size(); i++) {
+				run r;
+				r.fd = open(run_files[i].c_str(), O_RDONLY);
+				assert(r.fd > 0);
+				r.reader = new stream_reader(r.fd, 0, io_manager::get_filesize(r.fd), io_size);
+				r.buf = nullptr;
+				r.valid_size = 0;
+				r.pos = 0;
+				runs.push_back(r);
+
+				T head;
+				if(read_run(i, head))
+					heads.push(std::make_pair(head, i));
+			}
+		}
+
+		inline bool read_run(int i, T & record) {
+			run & r = runs[i];
+			if(r.pos == r.valid_size) {
+				if(!r.reader->next(r.buf, r.valid_size))
+					return false;
+				assert(r.valid_size % sizeof(T) == 0);
+				r.pos = 0;
+			}
+
+			record = *(T*)(r.buf + r.pos);
+			r.pos += sizeof(T);
+			return true;
+		}
+
+		std::string get_run_file(int i) {
+			// chunks of one file may be sorted at the same time
+			return file_name + ".run_" + std::to_string(offset) + "_" + std::to_string(i);
+		}
+
+		sorted_stream(const sorted_stream &) = delete;
+		sorted_stream & operator=(const sorted_stream &) = delete;
+	};
+
+	// appends records to a new file through a buffer of IO_SIZE bytes
+	template<typename T>
+	class record_writer {
+		int fd;
+		std::vector<T> buf;
+		size_t capacity;
+
+	public:
+		record_writer(const std::string & file_name) : capacity(std::max(IO_SIZE / (long)sizeof(T), 1L)) {
+			fd = open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
+			assert(fd > 0);
+			buf.reserve(capacity);
+		}
+
+		~record_writer() {
+			flush();
+			close(fd);
+		}
+
+		inline void write(const T & record) {
+			buf.push_back(record);
+			if(buf.size() == capacity)
+				flush();
+		}
+
+	private:
+		void flush() {
+			if(buf.empty())
+				return;
+			io_manager::append_to_file(fd, (char*)buf.data(), buf.size() * sizeof(T));
+			buf.clear();
+		}
+
+		record_writer(const record_writer &) = delete;
+		record_writer & operator=(const record_writer &) = delete;
+	};
+
+}
+
+#endif /* CORE_EXTERNAL_SORT_HPP_ */
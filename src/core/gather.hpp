@@ -49,13 +49,6 @@ namespace RStream {
 		}
 
 	private:
-		void load_vertices_hashMap(char* vertex_local_buf, const int vertex_file_size, std::unordered_map<VertexId, VertexDataType*> & vertex_map) {
-			for(size_t off = 0; off < vertex_file_size; off += context.vertex_unit){
-				VertexDataType* v = reinterpret_cast<VertexDataType*>(vertex_local_buf + off);
-				vertex_map[v->id] = v;
-			}
-		}
-
 		void gather_producer(Update_Stream in_update_stream, std::function<void(UpdateType*, VertexDataType*)> apply_one_update,
 								concurrent_queue<int> * task_queue) {
 
@@ -79,8 +72,7 @@ namespace RStream {
 				// vertex data fully loaded into memory
 				char * vertex_local_buf = new char[vertex_file_size];
 				io_manager::read_from_file(fd_vertex, vertex_local_buf, vertex_file_size, 0);
-				std::unordered_map<VertexId, VertexDataType*> vertex_map;
-				load_vertices_hashMap(vertex_local_buf, vertex_file_size, vertex_map);
+				vertex_view<VertexDataType> vertices(vertex_local_buf, vertex_file_size, vertex_start);
 
 				// streaming updates
 				char * update_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE * sizeof(UpdateType));
@@ -111,8 +103,7 @@ namespace RStream {
 						UpdateType * update = (UpdateType*)(update_local_buf + pos);
 
 						// get target vertex in vertex buf
-						size_t offset = (update->target - vertex_start) * sizeof(VertexDataType);
-						VertexDataType* dst_vertex = reinterpret_cast<VertexDataType*>(vertex_local_buf + offset);
+						VertexDataType* dst_vertex = vertices.get(update->target);
 
 	//						assert(vertex_map.find(update->target) != vertex_map.end());
 	//						VertexDataType * dst_vertex = vertex_map.find(update->target)->second;
@@ -0,0 +1,84 @@
+/*
+ * intersection.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ */
+
+#ifndef CORE_INTERSECTION_HPP_
+#define CORE_INTERSECTION_HPP_
+
+#include "../common/RStreamCommon.hpp"
+#include "../struct/type.hpp"
+
+namespace RStream {
+
+	typedef long (*count_function)(const VertexId * a, long size_a, const VertexId * b, long size_b);
+	typedef long (*intersect_function)(const VertexId * a, long size_a, const VertexId * b, long size_b, VertexId * out);
+
+	struct intersection_kernel {
+		const char * name;
+		count_function count;
+		intersect_function intersect;
+	};
+
+	// intersection of sorted ranges of distinct vertex ids, e.g. the neighbor ranges of edge_index.
+	// count() only counts the common ids, intersect() also writes them in order to out,
+	// which must have room for min(size_a, size_b) ids.
+	// ranges of similar length go through the best merge kernel the cpu supports (picked once, at first use),
+	// a range much shorter than the other is looked up in it by galloping instead.
+	class intersection {
+	public:
+		// length ratio from which galloping beats merging
+		static const long GALLOPING_RATIO = 32;
+
+		static inline long count(const VertexId * a, long size_a, const VertexId * b, long size_b) {
+			if(size_a > size_b) {
+				std::swap(a, b);
+				std::swap(size_a, size_b);
+			}
+			if(size_a == 0)
+				return 0;
+			if(size_a * GALLOPING_RATIO < size_b)
+				return count_galloping(a, size_a, b, size_b);
+			return get_kernel().count(a, size_a, b, size_b);
+		}
+
+		static inline long intersect(const VertexId * a, long size_a, const VertexId * b, long size_b, VertexId * out) {
+			if(size_a > size_b) {
+				std::swap(a, b);
+				std::swap(size_a, size_b);
+			}
+			if(size_a == 0)
+				return 0;
+			if(size_a * GALLOPING_RATIO < size_b)
+				return intersect_galloping(a, size_a, b, size_b, out);
+			return get_kernel().intersect(a, size_a, b, size_b, out);
+		}
+
+		// merge kernels used by count() and intersect(), each the fastest one the cpu supports
+		static const intersection_kernel & get_kernel();
+
+		// every kernel this cpu can run, from scalar to the widest one, for benchmarks and tests
+		static std::vector<intersection_kernel> get_supported_kernels();
+
+		static long count_scalar(const VertexId * a, long size_a, const VertexId * b, long size_b);
+		static long intersect_scalar(const VertexId * a, long size_a, const VertexId * b, long size_b, VertexId * out);
+
+		// a must be the shorter range
+		static long count_galloping(const VertexId * a, long size_a, const VertexId * b, long size_b);
+		static long intersect_galloping(const VertexId * a, long size_a, const VertexId * b, long size_b, VertexId * out);
+
+		static long count_sse(const VertexId * a, long size_a, const VertexId * b, long size_b);
+		static long intersect_sse(const VertexId * a, long size_a, const VertexId * b, long size_b, VertexId * out);
+
+		static long count_avx2(const VertexId * a, long size_a, const VertexId * b, long size_b);
+		static long intersect_avx2(const VertexId * a, long size_a, const VertexId * b, long size_b, VertexId * out);
+
+		static long count_avx512(const VertexId * a, long size_a, const VertexId * b, long size_b);
+		static long intersect_avx512(const VertexId * a, long size_a, const VertexId * b, long size_b, VertexId * out);
+	};
+
+}
+
+#endif /* CORE_INTERSECTION_HPP_ */
@@ -9,6 +9,7 @@
 #define CORE_IO_MANAGER_HPP_
 
 #include "../common/RStreamCommon.hpp"
+#include "constants.hpp"
 
 namespace RStream {
 	class io_manager {
@@ -78,6 +79,24 @@ namespace RStream {
 			}
 		}
 
+		// writes at offset, so that tasks can fill disjoint ranges of one file at the same time
+		static void write_to_file(int fd, char * buf, size_t fsize, size_t offset) {
+			size_t n_write = 0;
+			assert(fd > 0);
+
+			while(n_write < fsize) {
+				ssize_t n_bytes = pwrite(fd, buf, fsize - n_write, offset + n_write);
+				if(n_bytes == ssize_t(-1)) {
+					std::cout << "Write error! " << std::endl;
+					std::cout << strerror(errno) << std::endl;
+					assert(false);
+				}
+				assert(n_bytes > 0);
+				buf += n_bytes;
+				n_write += n_bytes;
+			}
+		}
+
 		static void append_to_file(int fd, char * buf, size_t fsize) {
 			assert(fd > 0);
 
@@ -97,6 +116,130 @@ namespace RStream {
 				n_write += n_bytes;
 			}
 		}
+
+		// issue the read on the background io threads, wait on the returned future before touching buf
+		static std::future<void> read_from_file_async(int fd, char * buf, size_t fsize, size_t offset);
+	};
+
+	// small pool of reader threads shared by all streaming loops, so disk reads overlap with computation
+	class io_thread_pool {
+	public:
+		static io_thread_pool & get_instance() {
+			static io_thread_pool pool(NUM_IO_THREADS);
+			return pool;
+		}
+
+		std::future<void> submit(const std::function<void()> & job) {
+			std::shared_ptr<std::packaged_task<void()>> task = std::make_shared<std::packaged_task<void()>>(job);
+			std::future<void> result = task->get_future();
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				jobs.push([task] { (*task)(); });
+			}
+			not_empty.notify_one();
+			return result;
+		}
+
+		~io_thread_pool() {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				stopped = true;
+			}
+			not_empty.notify_all();
+			for(auto & t : workers)
+				t.join();
+		}
+
+	private:
+		io_thread_pool(int num_threads) : stopped(false) {
+			for(int i = 0; i < num_threads; i++)
+				workers.push_back(std::thread(&io_thread_pool::worker, this));
+		}
+
+		io_thread_pool(const io_thread_pool &) = delete;
+		io_thread_pool & operator=(const io_thread_pool &) = delete;
+
+		void worker() {
+			while(true) {
+				std::function<void()> job;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					not_empty.wait(lock, [&] { return stopped || !jobs.empty(); });
+					if(jobs.empty())
+						return;
+					job = std::move(jobs.front());
+					jobs.pop();
+				}
+				job();
+			}
+		}
+
+		std::vector<std::thread> workers;
+		std::queue<std::function<void()>> jobs;
+		std::mutex mutex;
+		std::condition_variable not_empty;
+		bool stopped;
+	};
+
+	inline std::future<void> io_manager::read_from_file_async(int fd, char * buf, size_t fsize, size_t offset) {
+		return io_thread_pool::get_instance().submit([=] { io_manager::read_from_file(fd, buf, fsize, offset); });
+	}
+
+	/* double-buffered reader over [offset, offset + size) of fd, chunk n+1 is prefetched while the caller works on chunk n.
+	 * io_size should already be a multiple of the tuple size (see MPhase::get_real_io_size).
+	 */
+	class stream_reader {
+	public:
+		stream_reader(int _fd, long offset, long size, long _io_size) : fd(_fd), next_offset(offset), end_offset(offset + size), io_size(_io_size), current(0), pending_size(0) {
+			assert(fd > 0 && io_size > 0 && size >= 0);
+			bufs[0] = (char *)memalign(PAGE_SIZE, io_size);
+			bufs[1] = (char *)memalign(PAGE_SIZE, io_size);
+			prefetch();
+		}
+
+		~stream_reader() {
+			if(pending.valid())
+				pending.wait();
+			free(bufs[0]);
+			free(bufs[1]);
+		}
+
+		// hand out the next chunk; the previous one is recycled for prefetching, so it must not be used afterwards
+		bool next(char * & buf, long & valid_io_size) {
+			if(!pending.valid())
+				return false;
+
+			pending.get();
+			buf = bufs[current];
+			valid_io_size = pending_size;
+
+			current ^= 1;
+			prefetch();
+			return true;
+		}
+
+	private:
+		void prefetch() {
+			if(next_offset >= end_offset)
+				return;
+
+			pending_size = std::min(io_size, end_offset - next_offset);
+			pending = io_manager::read_from_file_async(fd, bufs[current], pending_size, next_offset);
+			next_offset += pending_size;
+		}
+
+		stream_reader(const stream_reader &) = delete;
+		stream_reader & operator=(const stream_reader &) = delete;
+
+		int fd;
+		long next_offset;
+		long end_offset;
+		long io_size;
+
+		char * bufs[2];
+		int current;
+		std::future<void> pending;
+		long pending_size;
 	};
 }
 
@@ -11,12 +11,17 @@
 namespace RStream {
 	class meta_info{
 	public:
-//		// get index when partition on vertices
+		// get index for partitions on vertices or on edges alike
 		static int get_index(VertexId id, const Engine & context) {
-			int partition_id = id / context.num_vertices_per_part;
-			return partition_id < (context.num_partitions - 1) ? partition_id : (context.num_partitions - 1);
+			return context.router.get_index(id);
 		}
 
+//		// get index when partition on vertices
+//		static int get_index(VertexId id, const Engine & context) {
+//			int partition_id = id / context.num_vertices_per_part;
+//			return partition_id < (context.num_partitions - 1) ? partition_id : (context.num_partitions - 1);
+//		}
+
 		// get index when partition on edges
 //		static int get_index(VertexId id, const Engine & context) {
 ////			for(unsigned int i = 0; i < context.vertex_intervals.size(); i++) {
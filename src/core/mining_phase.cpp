@@ -13,6 +13,8 @@ namespace RStream {
 
 		MPhase::MPhase(Engine & e, unsigned int maxsize) : context(e) {
 			max_size = maxsize;
+			// tuples of the final iteration must still fit in a quick pattern and a vertex set
+			assert(max_size < MAX_TUPLE_SIZE);
 			sizeof_in_tuple = 0;
 		}
 
@@ -22,6 +24,7 @@ namespace RStream {
 			atomic_num_producers = context.num_exec_threads;
 			atomic_partition_id = -1;
 			atomic_partition_number = context.num_partitions;
+			ready_partitions.reset();
 		}
 
 
@@ -37,26 +40,16 @@ namespace RStream {
 
 
 			// allocate global buffers for shuffling
-			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_out_tuple);
+			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_out_tuple, &ready_partitions);
 
-			//load all edges in memory
-			concurrent_queue<int> * read_task_queue = new concurrent_queue<int>(context.num_partitions);
-			for(int partition_id = 0; partition_id < context.num_partitions; partition_id++) {
-				read_task_queue->push(partition_id);
-			}
-			std::vector<Element_In_Tuple>* edge_hashmap = new std::vector<Element_In_Tuple>[context.num_vertices];
-			std::vector<std::thread> read_threads;
-			for(int i = 0; i < context.num_threads; i++)
-				read_threads.push_back( std::thread([=] { this->edges_loader(edge_hashmap, read_task_queue); } ));
-
-			for(auto &t : read_threads)
-				t.join();
+			// all edges are indexed in memory, once per engine
+			const edge_index * edges = &context.get_edge_index();
 
 			// exec threads will produce updates and push into shuffle buffers
 			concurrent_queue<std::tuple<int, long, long>>* task_queue = divide_tasks(context.num_partitions, context.filename, in_update_stream, sizeof_in_tuple, CHUNK_SIZE);
 			std::vector<std::thread> exec_threads;
 			for(int i = 0; i < context.num_exec_threads; i++)
-				exec_threads.push_back( std::thread([=] { this->join_allkeys_nonshuffle_tuple_producer(in_update_stream, buffers_for_shuffle, task_queue, edge_hashmap); } ));
+				exec_threads.push_back( std::thread([=] { this->join_allkeys_nonshuffle_tuple_producer(in_update_stream, buffers_for_shuffle, task_queue, edges); } ));
 
 			// write threads will flush shuffle buffer to update out stream file as long as it's full
 			std::vector<std::thread> write_threads;
@@ -67,14 +60,15 @@ namespace RStream {
 			for(auto & t : exec_threads)
 				t.join();
 
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
 			for(auto &t : write_threads)
 				t.join();
 
 			delete[] buffers_for_shuffle;
 			delete task_queue;
 
-			delete[] edge_hashmap;
-			delete read_task_queue;
 
 			sizeof_in_tuple = sizeof_out_tuple;
 
@@ -89,26 +83,16 @@ namespace RStream {
 
 
 			// allocate global buffers for shuffling
-			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_out_tuple);
-
-			//load all edges in memory
-			concurrent_queue<int> * read_task_queue = new concurrent_queue<int>(context.num_partitions);
-			for(int partition_id = 0; partition_id < context.num_partitions; partition_id++) {
-				read_task_queue->push(partition_id);
-			}
-			std::vector<Base_Element>* edge_hashmap = new std::vector<Base_Element>[context.num_vertices];
-			std::vector<std::thread> read_threads;
-			for(int i = 0; i < context.num_threads; i++)
-				read_threads.push_back( std::thread([=] { this->edges_loader(edge_hashmap, read_task_queue); } ));
+			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_out_tuple, &ready_partitions);
 
-			for(auto &t : read_threads)
-				t.join();
+			// all edges are indexed in memory, once per engine
+			const edge_index * edges = &context.get_edge_index();
 
 			// exec threads will produce updates and push into shuffle buffers
 			concurrent_queue<std::tuple<int, long, long>>* task_queue = divide_tasks(context.num_partitions, context.filename, in_update_stream, sizeof_in_tuple, CHUNK_SIZE);
 			std::vector<std::thread> exec_threads;
 			for(int i = 0; i < context.num_exec_threads; i++)
-				exec_threads.push_back( std::thread([=] { this->join_allkeys_nonshuffle_tuple_producer_clique(in_update_stream, buffers_for_shuffle, task_queue, edge_hashmap); } ));
+				exec_threads.push_back( std::thread([=] { this->join_allkeys_nonshuffle_tuple_producer_clique(in_update_stream, buffers_for_shuffle, task_queue, edges); } ));
 
 			// write threads will flush shuffle buffer to update out stream file as long as it's full
 			std::vector<std::thread> write_threads;
@@ -119,59 +103,62 @@ namespace RStream {
 			for(auto & t : exec_threads)
 				t.join();
 
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
 			for(auto &t : write_threads)
 				t.join();
 
 			delete[] buffers_for_shuffle;
 			delete task_queue;
 
-			delete[] edge_hashmap;
-			delete read_task_queue;
 
 			sizeof_in_tuple = sizeof_out_tuple;
 
 			return update_c;
 		}
 
-		void MPhase::edges_loader(std::vector<Base_Element>* edge_hashmap, concurrent_queue<int> * read_task_queue){
-			int partition_id = -1;
-			while(read_task_queue->test_pop_atomic(partition_id)){
-				int fd_edge = open((context.filename + "." + std::to_string(partition_id)).c_str(), O_RDONLY);
-//				if(fd_edge <= 0){
-//					std::cout << (context.filename + "." + std::to_string(partition_id)) << std::endl;
-//				}
-				assert(fd_edge > 0);
-				long edge_file_size = io_manager::get_filesize(fd_edge);
+		Update_Stream MPhase::join_all_keys_nonshuffle_clique_intersect(Update_Stream in_update_stream) {
+			atomic_init();
+			int sizeof_out_tuple = sizeof_in_tuple + sizeof(Base_Element);
 
-				// edges are fully loaded into memory
-				char * edge_local_buf = (char *)malloc(edge_file_size);
-				io_manager::read_from_file(fd_edge, edge_local_buf, edge_file_size, 0);
+			Update_Stream update_c = Engine::update_count++;
 
-				// build edge hashmap
-				build_edge_hashmap(edge_local_buf, edge_hashmap, edge_file_size, 0);
 
-				free(edge_local_buf);
-				close(fd_edge);
-			}
-		}
+			// allocate global buffers for shuffling
+			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_out_tuple, &ready_partitions);
 
-		void MPhase::edges_loader(std::vector<Element_In_Tuple>* edge_hashmap, concurrent_queue<int> * read_task_queue){
-			int partition_id = -1;
-			while(read_task_queue->test_pop_atomic(partition_id)){
-				int fd_edge = open((context.filename + "." + std::to_string(partition_id)).c_str(), O_RDONLY);
-				assert(fd_edge > 0);
-				long edge_file_size = io_manager::get_filesize(fd_edge);
+			// all edges are indexed in memory, once per engine
+			const edge_index * edges = &context.get_edge_index();
 
-				// edges are fully loaded into memory
-				char * edge_local_buf = (char *)malloc(edge_file_size);
-				io_manager::read_from_file(fd_edge, edge_local_buf, edge_file_size, 0);
+			// exec threads will produce updates and push into shuffle buffers
+			concurrent_queue<std::tuple<int, long, long>>* task_queue = divide_tasks(context.num_partitions, context.filename, in_update_stream, sizeof_in_tuple, CHUNK_SIZE);
+			std::vector<std::thread> exec_threads;
+			for(int i = 0; i < context.num_exec_threads; i++)
+				exec_threads.push_back( std::thread([=] { this->join_allkeys_nonshuffle_tuple_producer_clique_intersect(in_update_stream, buffers_for_shuffle, task_queue, edges); } ));
 
-				// build edge hashmap
-				build_edge_hashmap(edge_local_buf, edge_hashmap, edge_file_size, 0);
+			// write threads will flush shuffle buffer to update out stream file as long as it's full
+			std::vector<std::thread> write_threads;
+			for(int i = 0; i < context.num_write_threads; i++)
+				write_threads.push_back(std::thread(&MPhase::consumer, this, update_c, buffers_for_shuffle));
 
-				free(edge_local_buf);
-				close(fd_edge);
-			}
+			// join all threads
+			for(auto & t : exec_threads)
+				t.join();
+
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
+			for(auto &t : write_threads)
+				t.join();
+
+			delete[] buffers_for_shuffle;
+			delete task_queue;
+
+
+			sizeof_in_tuple = sizeof_out_tuple;
+
+			return update_c;
 		}
 
 		/** join update stream with edge stream to generate non-shuffled update stream
@@ -193,7 +180,7 @@ namespace RStream {
 			concurrent_queue<std::tuple<int, long, long>>* task_queue = divide_tasks(context.num_partitions, context.filename, in_update_stream, sizeof_in_tuple, CHUNK_SIZE);
 
 			// allocate global buffers for shuffling
-			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_out_tuple);
+			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_out_tuple, &ready_partitions);
 
 			// exec threads will produce updates and push into shuffle buffers
 			std::vector<std::thread> exec_threads;
@@ -209,6 +196,9 @@ namespace RStream {
 			for(auto & t : exec_threads)
 				t.join();
 
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
 //			std::cout << "finish producers." << std::endl;
 
 			for(auto &t : write_threads)
@@ -238,7 +228,7 @@ namespace RStream {
 			}
 
 			// allocate global buffers for shuffling
-			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_in_tuple);
+			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_in_tuple, &ready_partitions);
 
 			// exec threads will produce updates and push into shuffle buffers
 			std::vector<std::thread> exec_threads;
@@ -254,6 +244,9 @@ namespace RStream {
 			for(auto & t : exec_threads)
 				t.join();
 
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
 			for(auto &t : write_threads)
 				t.join();
 
@@ -277,7 +270,7 @@ namespace RStream {
 			}
 
 			// allocate global buffers for shuffling
-			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_in_tuple);
+			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_in_tuple, &ready_partitions);
 
 			// exec threads will produce updates and push into shuffle buffers
 			std::vector<std::thread> exec_threads;
@@ -293,6 +286,9 @@ namespace RStream {
 			for(auto & t : exec_threads)
 				t.join();
 
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
 			for(auto &t : write_threads)
 				t.join();
 
@@ -318,7 +314,7 @@ namespace RStream {
 			}
 
 			// allocate global buffers for shuffling
-			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_in_tuple);
+			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_in_tuple, &ready_partitions);
 
 			// exec threads will produce updates and push into shuffle buffers
 			std::vector<std::thread> exec_threads;
@@ -334,6 +330,9 @@ namespace RStream {
 			for(auto & t : exec_threads)
 				t.join();
 
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
 			for(auto &t : write_threads)
 				t.join();
 
@@ -363,7 +362,7 @@ namespace RStream {
 			concurrent_queue<std::tuple<int, long, long>>* task_queue = divide_tasks(context.num_partitions, context.filename, in_update_stream, sizeof_in_tuple, CHUNK_SIZE);
 
 			// allocate global buffers for shuffling
-			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_in_tuple);
+			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_in_tuple, &ready_partitions);
 
 			// exec threads will produce updates and push into shuffle buffers
 			std::vector<std::thread> exec_threads;
@@ -379,6 +378,9 @@ namespace RStream {
 			for(auto & t : exec_threads)
 				t.join();
 
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
 			for(auto &t : write_threads)
 				t.join();
 
@@ -403,7 +405,7 @@ namespace RStream {
 			concurrent_queue<std::tuple<int, long, long>>* task_queue = divide_tasks(context.num_partitions, context.filename, in_update_stream, sizeof_in_tuple, CHUNK_SIZE);
 
 			// allocate global buffers for shuffling
-			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_in_tuple);
+			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_in_tuple, &ready_partitions);
 
 			// exec threads will produce updates and push into shuffle buffers
 			std::vector<std::thread> exec_threads;
@@ -419,6 +421,9 @@ namespace RStream {
 			for(auto & t : exec_threads)
 				t.join();
 
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
 			for(auto &t : write_threads)
 				t.join();
 
@@ -448,7 +453,7 @@ namespace RStream {
 			concurrent_queue<std::tuple<int, long, long>>* task_queue = divide_tasks(context.num_partitions, context.filename, in_update_stream, sizeof_in_tuple, CHUNK_SIZE);
 
 			// allocate global buffers for shuffling
-			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_out_tuple);
+			global_buffer_for_mining ** buffers_for_shuffle = buffer_manager_for_mining::get_global_buffers_for_mining(context.num_partitions, sizeof_out_tuple, &ready_partitions);
 
 			// exec threads will produce updates and push into shuffle buffers
 			std::vector<std::thread> exec_threads;
@@ -464,6 +469,9 @@ namespace RStream {
 			for(auto & t : exec_threads)
 				t.join();
 
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
 			for(auto &t : write_threads)
 				t.join();
 
@@ -507,6 +515,11 @@ namespace RStream {
 
 		// each exec thread generates a join producer
 		void MPhase::join_all_keys_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue) {
+			// stage tuples per partition locally, publish them to the shared buffers in batches
+			local_buffer_for_mining ** local_buffers = buffer_manager_for_mining::get_local_buffers_for_mining(buffers_for_shuffle, context.num_partitions);
+			local_pattern_table patterns;
+			const edge_index * edges = &context.get_edge_index();
+
 			std::tuple<int, long, long> task_id (-1, -1, -1);
 
 			// pop from queue
@@ -518,23 +531,6 @@ namespace RStream {
 
 //				Logger::print_thread_info_locked("as a (join-all-keys) producer dealing with partition " + get_string_task_tuple(task_id) + "\n");
 
-
-				int fd_edge = open((context.filename + "." + std::to_string(partition_id)).c_str(), O_RDONLY);
-				assert(fd_edge > 0);
-				long edge_file_size = io_manager::get_filesize(fd_edge);
-
-				// edges are fully loaded into memory
-				char * edge_local_buf = (char *)malloc(edge_file_size);
-				io_manager::read_from_file(fd_edge, edge_local_buf, edge_file_size, 0);
-
-				// build edge hashmap
-				const int n_vertices = context.vertex_intervals[partition_id].second - context.vertex_intervals[partition_id].first + 1;
-				int vertex_start = context.vertex_intervals[partition_id].first;
-				assert(n_vertices > 0 && vertex_start >= 0);
-				std::vector<Element_In_Tuple> edge_hashmap[n_vertices];
-				build_edge_hashmap(edge_local_buf, edge_hashmap, edge_file_size, vertex_start);
-
-
 				int fd_update = open((context.filename + "." + std::to_string(partition_id) + ".update_stream_" + std::to_string(in_update_stream)).c_str(), O_RDONLY);
 				assert(fd_update > 0);
 				// get file size
@@ -542,28 +538,14 @@ namespace RStream {
 				long update_file_size = size_task;
 
 				// streaming updates
-				char * update_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
-				long real_io_size = get_real_io_size(IO_SIZE, sizeof_in_tuple);
-				int streaming_counter = update_file_size / real_io_size + 1;
-
+				stream_reader update_reader(fd_update, offset_task, update_file_size, get_real_io_size(IO_SIZE, sizeof_in_tuple));
+				char * update_local_buf = nullptr;
 				long valid_io_size = 0;
-//				long offset = 0;
-				long offset = offset_task;
 
 				// for all streaming updates
-				for(int counter = 0; counter < streaming_counter; counter++) {
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-						valid_io_size = update_file_size - real_io_size * (streaming_counter - 1);
-					else
-						valid_io_size = real_io_size;
-
+				while(update_reader.next(update_local_buf, valid_io_size)) {
 					assert(valid_io_size % sizeof_in_tuple == 0);
 
-					io_manager::read_from_file(fd_update, update_local_buf, valid_io_size, offset);
-					offset += valid_io_size;
-
 					// streaming updates in, do hash join
 					for(long pos = 0; pos < valid_io_size; pos += sizeof_in_tuple) {
 //						// get an in_update_tuple
@@ -582,9 +564,10 @@ namespace RStream {
 //						VertexId key = in_update_tuple.at(key_index).vertex_id;
 
 						// get an in_update_tuple
-						std::unordered_set<VertexId> vertices_set;
+						Vertex_Set vertices_set;
 						MTuple_join in_update_tuple(sizeof_in_tuple);
 						get_an_in_update(update_local_buf + pos, in_update_tuple, vertices_set);
+						unsigned int parent_pattern = in_update_tuple.get_pattern_id();
 //						std::cout << in_update_tuple << std::endl;
 
 						// get key index
@@ -594,15 +577,16 @@ namespace RStream {
 						// get vertex_id as the key to index edge hashmap
 						VertexId key = in_update_tuple.at(key_index).vertex_id;
 
-						for(Element_In_Tuple element : edge_hashmap[key - vertex_start]) {
+						for(long k = edges->begin(key); k < edges->end(key); k++) {
 							// generate a new out update tuple
-							Element_In_Tuple new_element(element.vertex_id, (BYTE)0, element.edge_label, element.vertex_label, key_index);
+							Element_In_Tuple new_element(edges->neighbor(k), (BYTE)0, (BYTE)0, edges->label(k), key_index);
 							bool vertex_existed = gen_an_out_update(in_update_tuple, new_element, key_index, vertices_set);
 
 							// remove automorphism, only keep one unique tuple.
 							if(!filter_join(in_update_tuple) && !Pattern::is_automorphism(in_update_tuple, vertex_existed)){
 //								assert(partition_id == get_global_buffer_index(key));
-								shuffle_on_all_keys(in_update_tuple, buffers_for_shuffle);
+								set_pattern_id(in_update_tuple, patterns, parent_pattern, vertices_set);
+								shuffle_on_all_keys(in_update_tuple, local_buffers);
 							}
 
 //							in_update_tuple.pop_back();
@@ -612,13 +596,10 @@ namespace RStream {
 					}
 				}
 
-				free(update_local_buf);
-				free(edge_local_buf);
-
 				close(fd_update);
-				close(fd_edge);
 			}
 
+			buffer_manager_for_mining::release_local_buffers_for_mining(local_buffers, context.num_partitions);
 			atomic_num_producers--;
 		}
 
@@ -722,7 +703,11 @@ namespace RStream {
 //		}
 
 		// each exec thread generates a join producer
-		void MPhase::join_allkeys_nonshuffle_tuple_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, std::vector<Element_In_Tuple> * edge_hashmap) {
+		void MPhase::join_allkeys_nonshuffle_tuple_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, const edge_index * edges) {
+			// stage tuples per partition locally, publish them to the shared buffers in batches
+			local_buffer_for_mining ** local_buffers = buffer_manager_for_mining::get_local_buffers_for_mining(buffers_for_shuffle, context.num_partitions);
+			local_pattern_table patterns;
+
 			std::tuple<int, long, long> task_id (-1, -1, -1);
 
 			// pop from queue
@@ -743,49 +728,33 @@ namespace RStream {
 				long update_file_size = size_task;
 
 				// streaming updates
-				char * update_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
-				long real_io_size = get_real_io_size(IO_SIZE, sizeof_in_tuple);
-				int streaming_counter = update_file_size / real_io_size + 1;
-//				std::cout << "streaming counter: " << streaming_counter << std::endl;
-
+				stream_reader update_reader(fd_update, offset_task, update_file_size, get_real_io_size(IO_SIZE, sizeof_in_tuple));
+				char * update_local_buf = nullptr;
 				long valid_io_size = 0;
-//				long offset = 0;
-				long offset = offset_task;
 
 				// for all streaming updates
-				for(int counter = 0; counter < streaming_counter; counter++) {
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-						valid_io_size = update_file_size - real_io_size * (streaming_counter - 1);
-					else
-						valid_io_size = real_io_size;
-
+				while(update_reader.next(update_local_buf, valid_io_size)) {
 					assert(valid_io_size % sizeof_in_tuple == 0);
 
-					io_manager::read_from_file(fd_update, update_local_buf, valid_io_size, offset);
-					offset += valid_io_size;
-
 					// streaming updates in, do hash join
 					for(long pos = 0; pos < valid_io_size; pos += sizeof_in_tuple) {
 						// get an in_update_tuple
-						std::unordered_set<VertexId> vertices_set;
+						Vertex_Set vertices_set;
 						MTuple_join in_update_tuple(sizeof_in_tuple);
 						get_an_in_update(update_local_buf + pos, in_update_tuple, vertices_set);
+						unsigned int parent_pattern = in_update_tuple.get_pattern_id();
 //						std::cout << in_update_tuple << std::endl;
 
-						std::unordered_set<VertexId> set;
-//						set.reserve(vertices_set.size());
+						Vertex_Set set;
 						for(unsigned int i = 0; i < in_update_tuple.get_size(); ++i){
 							VertexId id = in_update_tuple.at(i).vertex_id;
 
 							// check if vertex id exsited already
-							if(set.find(id) == set.end()){
-								set.insert(id);
+							if(set.insert(id)){
 
-								for(Element_In_Tuple& element : edge_hashmap[id]) {
+								for(long k = edges->begin(id); k < edges->end(id); k++) {
 									// generate a new out update tuple
-									Element_In_Tuple new_element(element.vertex_id, (BYTE)0, element.edge_label, element.vertex_label, (BYTE)i);
+									Element_In_Tuple new_element(edges->neighbor(k), (BYTE)0, (BYTE)0, edges->label(k), (BYTE)i);
 									bool vertex_existed = gen_an_out_update(in_update_tuple, new_element, (BYTE)i, vertices_set);
 		//							std::cout << in_update_tuple  << " --> " << Pattern::is_automorphism(in_update_tuple)
 		//								<< ", " << filter_join(in_update_tuple) << std::endl;
@@ -805,8 +774,9 @@ namespace RStream {
 									// remove automorphism, only keep one unique tuple.
 									if(!filter_join(in_update_tuple) && !Pattern::is_automorphism(in_update_tuple, vertex_existed)){
 //										insert_tuple_to_buffer(partition_id, in_update_tuple, buffers_for_shuffle);
+										set_pattern_id(in_update_tuple, patterns, parent_pattern, vertices_set);
 
-										insert_tuple_to_buffer(target_partition++, in_update_tuple, buffers_for_shuffle);
+										insert_tuple_to_buffer(target_partition++, in_update_tuple, local_buffers);
 										if(target_partition == context.num_partitions)
 											target_partition = 0;
 									}
@@ -818,15 +788,18 @@ namespace RStream {
 					}
 				}
 
-				free(update_local_buf);
 				close(fd_update);
 			}
 
+			buffer_manager_for_mining::release_local_buffers_for_mining(local_buffers, context.num_partitions);
 			atomic_num_producers--;
 		}
 
 
-		void MPhase::join_allkeys_nonshuffle_tuple_producer_clique(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, std::vector<Base_Element> * edge_hashmap) {
+		void MPhase::join_allkeys_nonshuffle_tuple_producer_clique(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, const edge_index * edges) {
+			// stage tuples per partition locally, publish them to the shared buffers in batches
+			local_buffer_for_mining ** local_buffers = buffer_manager_for_mining::get_local_buffers_for_mining(buffers_for_shuffle, context.num_partitions);
+
 			std::tuple<int, long, long> task_id (-1, -1, -1);
 
 			// pop from queue
@@ -847,29 +820,14 @@ namespace RStream {
 				long update_file_size = size_task;
 
 				// streaming updates
-				char * update_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
-				long real_io_size = get_real_io_size(IO_SIZE, sizeof_in_tuple);
-				int streaming_counter = update_file_size / real_io_size + 1;
-//				std::cout << "streaming counter: " << streaming_counter << std::endl;
-
+				stream_reader update_reader(fd_update, offset_task, update_file_size, get_real_io_size(IO_SIZE, sizeof_in_tuple));
+				char * update_local_buf = nullptr;
 				long valid_io_size = 0;
-//				long offset = 0;
-				long offset = offset_task;
 
 				// for all streaming updates
-				for(int counter = 0; counter < streaming_counter; counter++) {
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-						valid_io_size = update_file_size - real_io_size * (streaming_counter - 1);
-					else
-						valid_io_size = real_io_size;
-
+				while(update_reader.next(update_local_buf, valid_io_size)) {
 					assert(valid_io_size % sizeof_in_tuple == 0);
 
-					io_manager::read_from_file(fd_update, update_local_buf, valid_io_size, offset);
-					offset += valid_io_size;
-
 					// streaming updates in, do hash join
 					for(long pos = 0; pos < valid_io_size; pos += sizeof_in_tuple) {
 						MTuple_join_simple in_update_tuple(sizeof_in_tuple);
@@ -878,15 +836,19 @@ namespace RStream {
 						for(unsigned int i = 0; i < in_update_tuple.get_size(); ++i){
 							VertexId id = in_update_tuple.at(i).id;
 
-							for(Base_Element& element : edge_hashmap[id]) {
+							for(long k = edges->begin(id); k < edges->end(id); k++) {
+								// only extend to larger neighbors
+								if(edges->neighbor(k) <= id)
+									continue;
+
 								// generate a new out update tuple
-//								Base_Element new_element(element.id);
+								Base_Element element(edges->neighbor(k));
 								gen_an_out_update(in_update_tuple, element);
 //								std::cout << in_update_tuple  << " --> " << filter_join_clique(in_update_tuple) << std::endl;
 
 								// remove automorphism, only keep one unique tuple.
 								if(!filter_join_clique(in_update_tuple)){
-									shuffle(in_update_tuple, buffers_for_shuffle, partition_id);
+									shuffle(in_update_tuple, local_buffers, partition_id);
 								}
 
 								in_update_tuple.pop();
@@ -895,15 +857,20 @@ namespace RStream {
 					}
 				}
 
-				free(update_local_buf);
 				close(fd_update);
 			}
 
+			buffer_manager_for_mining::release_local_buffers_for_mining(local_buffers, context.num_partitions);
 			atomic_num_producers--;
 		}
 
 		// each exec thread generates a join producer
 		void MPhase::join_mining_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue) {
+			// stage tuples per partition locally, publish them to the shared buffers in batches
+			local_buffer_for_mining ** local_buffers = buffer_manager_for_mining::get_local_buffers_for_mining(buffers_for_shuffle, context.num_partitions);
+			local_pattern_table patterns;
+			const edge_index * edges = &context.get_edge_index();
+
 			std::tuple<int, long, long> task_id (-1, -1, -1);
 
 			// pop from queue
@@ -915,26 +882,6 @@ namespace RStream {
 
 //				Logger::print_thread_info_locked("as a (join-mining) producer dealing with partition " + get_string_task_tuple(task_id) + "\n");
 
-
-				int fd_edge = open((context.filename + "." + std::to_string(partition_id)).c_str(), O_RDONLY);
-				assert(fd_edge > 0);
-				long edge_file_size = io_manager::get_filesize(fd_edge);
-
-				// edges are fully loaded into memory
-				char * edge_local_buf = (char *)malloc(edge_file_size);
-				io_manager::read_from_file(fd_edge, edge_local_buf, edge_file_size, 0);
-
-				// build edge hashmap
-				VertexId n_vertices = context.vertex_intervals[partition_id].second - context.vertex_intervals[partition_id].first + 1;
-				VertexId vertex_start = context.vertex_intervals[partition_id].first;
-				assert(n_vertices > 0 && vertex_start >= 0);
-				std::vector<Element_In_Tuple> edge_hashmap[n_vertices];
-				build_edge_hashmap(edge_local_buf, edge_hashmap, edge_file_size, vertex_start);
-//				//for debugging
-//				std::cout << "finish edge hash building" << std::endl;
-//				printout_edgehashmap(edge_hashmap, n_vertices);
-
-
 				int fd_update = open((context.filename + "." + std::to_string(partition_id) + ".update_stream_" + std::to_string(in_update_stream)).c_str(), O_RDONLY);
 				assert(fd_update > 0);
 
@@ -943,35 +890,21 @@ namespace RStream {
 				long update_file_size = size_task;
 
 				// streaming updates
-					char * update_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
-					long real_io_size = get_real_io_size(IO_SIZE, sizeof_in_tuple);
-					int streaming_counter = update_file_size / real_io_size + 1;
-	//				std::cout << "streaming counter: " << streaming_counter << std::endl;
-
+					stream_reader update_reader(fd_update, offset_task, update_file_size, get_real_io_size(IO_SIZE, sizeof_in_tuple));
+					char * update_local_buf = nullptr;
 					long valid_io_size = 0;
-	//				long offset = 0;
-					long offset = offset_task;
 
 					// for all streaming updates
-					for(int counter = 0; counter < streaming_counter; counter++) {
-						// last streaming
-						if(counter == streaming_counter - 1)
-							// TODO: potential overflow?
-							valid_io_size = update_file_size - real_io_size * (streaming_counter - 1);
-						else
-							valid_io_size = real_io_size;
-
+					while(update_reader.next(update_local_buf, valid_io_size)) {
 						assert(valid_io_size % sizeof_in_tuple == 0);
 
-					io_manager::read_from_file(fd_update, update_local_buf, valid_io_size, offset);
-					offset += valid_io_size;
-
 					// streaming updates in, do hash join
 					for(long pos = 0; pos < valid_io_size; pos += sizeof_in_tuple) {
 						// get an in_update_tuple
-						std::unordered_set<VertexId> vertices_set;
+						Vertex_Set vertices_set;
 						MTuple_join in_update_tuple(sizeof_in_tuple);
 						get_an_in_update(update_local_buf + pos, in_update_tuple, vertices_set);
+						unsigned int parent_pattern = in_update_tuple.get_pattern_id();
 //						std::cout << in_update_tuple << std::endl;
 
 						// get key index
@@ -981,9 +914,9 @@ namespace RStream {
 						// get vertex_id as the key to index edge hashmap
 						VertexId key = in_update_tuple.at(key_index).vertex_id;
 
-						for(Element_In_Tuple element : edge_hashmap[key - vertex_start]) {
+						for(long k = edges->begin(key); k < edges->end(key); k++) {
 							// generate a new out update tuple
-							Element_In_Tuple new_element(element.vertex_id, (BYTE)0, element.edge_label, element.vertex_label, key_index);
+							Element_In_Tuple new_element(edges->neighbor(k), (BYTE)0, (BYTE)0, edges->label(k), key_index);
 							bool vertex_existed = gen_an_out_update(in_update_tuple, new_element, key_index, vertices_set);
 //							std::cout << in_update_tuple  << " --> " << Pattern::is_automorphism(in_update_tuple)
 //								<< ", " << filter_join(in_update_tuple) << std::endl;
@@ -991,7 +924,8 @@ namespace RStream {
 							// remove automorphism, only keep one unique tuple.
 							if(!filter_join(in_update_tuple) && !Pattern::is_automorphism(in_update_tuple, vertex_existed)){
 //								assert(partition_id == get_global_buffer_index(key));
-								insert_tuple_to_buffer(partition_id, in_update_tuple, buffers_for_shuffle);
+								set_pattern_id(in_update_tuple, patterns, parent_pattern, vertices_set);
+								insert_tuple_to_buffer(partition_id, in_update_tuple, local_buffers);
 							}
 
 							in_update_tuple.pop();
@@ -999,27 +933,24 @@ namespace RStream {
 					}
 				}
 
-				free(update_local_buf);
-				free(edge_local_buf);
-
 				close(fd_update);
-				close(fd_edge);
 			}
 
+			buffer_manager_for_mining::release_local_buffers_for_mining(local_buffers, context.num_partitions);
 			atomic_num_producers--;
 		}
 
 
-		void MPhase::insert_tuple_to_buffer(int partition_id, std::vector<Element_In_Tuple>& in_update_tuple, global_buffer_for_mining** buffers_for_shuffle) {
+		void MPhase::insert_tuple_to_buffer(int partition_id, std::vector<Element_In_Tuple>& in_update_tuple, local_buffer_for_mining ** local_buffers) {
 			char* out_update = reinterpret_cast<char*>(in_update_tuple.data());
-			global_buffer_for_mining* global_buf = buffer_manager_for_mining::get_global_buffer_for_mining(buffers_for_shuffle, context.num_partitions, partition_id);
-			global_buf->insert(out_update);
+			local_buffer_for_mining* local_buf = buffer_manager_for_mining::get_local_buffer_for_mining(local_buffers, context.num_partitions, partition_id);
+			local_buf->insert(out_update);
 		}
 
-		void MPhase::insert_tuple_to_buffer_clique(int partition_id, std::vector<Base_Element>& in_update_tuple, global_buffer_for_mining** buffers_for_shuffle) {
+		void MPhase::insert_tuple_to_buffer_clique(int partition_id, std::vector<Base_Element>& in_update_tuple, local_buffer_for_mining ** local_buffers) {
 			char* out_update = reinterpret_cast<char*>(in_update_tuple.data());
-			global_buffer_for_mining* global_buf = buffer_manager_for_mining::get_global_buffer_for_mining(buffers_for_shuffle, context.num_partitions, partition_id);
-			global_buf->insert(out_update);
+			local_buffer_for_mining* local_buf = buffer_manager_for_mining::get_local_buffer_for_mining(local_buffers, context.num_partitions, partition_id);
+			local_buf->insert(out_update);
 		}
 
 //		void MPhase::insert_tuple_to_buffer(int partition_id, std::vector<Element_In_Tuple>& in_update_tuple, global_buffer_for_mining** buffers_for_shuffle) {
@@ -1028,21 +959,24 @@ namespace RStream {
 //			global_buf->insert(out_update);
 //		}
 
-		void MPhase::insert_tuple_to_buffer(int partition_id, MTuple& in_update_tuple, global_buffer_for_mining** buffers_for_shuffle) {
+		void MPhase::insert_tuple_to_buffer(int partition_id, MTuple& in_update_tuple, local_buffer_for_mining ** local_buffers) {
 			char* out_update = reinterpret_cast<char*>(in_update_tuple.get_elements());
-			global_buffer_for_mining* global_buf = buffer_manager_for_mining::get_global_buffer_for_mining(buffers_for_shuffle, context.num_partitions, partition_id);
-			global_buf->insert(out_update);
+			local_buffer_for_mining* local_buf = buffer_manager_for_mining::get_local_buffer_for_mining(local_buffers, context.num_partitions, partition_id);
+			local_buf->insert(out_update);
 		}
 
-		void MPhase::insert_tuple_to_buffer(int partition_id, MTuple_join& in_update_tuple, global_buffer_for_mining** buffers_for_shuffle) {
+		void MPhase::insert_tuple_to_buffer(int partition_id, MTuple_join& in_update_tuple, local_buffer_for_mining ** local_buffers) {
 			char* out_elements = reinterpret_cast<char*>(in_update_tuple.get_elements());
 			char* out_added = reinterpret_cast<char*>(in_update_tuple.get_added_element());
-			global_buffer_for_mining* global_buf = buffer_manager_for_mining::get_global_buffer_for_mining(buffers_for_shuffle, context.num_partitions, partition_id);
-			global_buf->insert(out_elements, out_added);
+			local_buffer_for_mining* local_buf = buffer_manager_for_mining::get_local_buffer_for_mining(local_buffers, context.num_partitions, partition_id);
+			local_buf->insert(out_elements, out_added);
 		}
 
 
 		void MPhase::shuffle_all_keys_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue) {
+			// stage tuples per partition locally, publish them to the shared buffers in batches
+			local_buffer_for_mining ** local_buffers = buffer_manager_for_mining::get_local_buffers_for_mining(buffers_for_shuffle, context.num_partitions);
+
 			std::tuple<int, long, long> task_id (-1, -1, -1);
 
 			// pop from queue
@@ -1062,48 +996,37 @@ namespace RStream {
 				long update_file_size = size_task;
 
 				// streaming updates
-				char * update_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
-				long real_io_size = get_real_io_size(IO_SIZE, sizeof_in_tuple);
-				int streaming_counter = update_file_size / real_io_size + 1;
-
+				stream_reader update_reader(fd_update, offset_task, update_file_size, get_real_io_size(IO_SIZE, sizeof_in_tuple));
+				char * update_local_buf = nullptr;
 				long valid_io_size = 0;
-//				long offset = 0;
-				long offset = offset_task;
 
 				// for all streaming updates
-				for(int counter = 0; counter < streaming_counter; counter++) {
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-						valid_io_size = update_file_size - real_io_size * (streaming_counter - 1);
-					else
-						valid_io_size = real_io_size;
-
+				while(update_reader.next(update_local_buf, valid_io_size)) {
 					assert(valid_io_size % sizeof_in_tuple == 0);
 
-					io_manager::read_from_file(fd_update, update_local_buf, valid_io_size, offset);
-					offset += valid_io_size;
-
 					// streaming updates in, do hash join
 					for(long pos = 0; pos < valid_io_size; pos += sizeof_in_tuple) {
 						// get an in_update_tuple
 						MTuple in_update_tuple(sizeof_in_tuple);
 						get_an_in_update(update_local_buf + pos, in_update_tuple);
 
-						shuffle_on_all_keys(in_update_tuple, buffers_for_shuffle);
+						shuffle_on_all_keys(in_update_tuple, local_buffers);
 					}
 				}
 
-				free(update_local_buf);
 				close(fd_update);
 			}
 
+			buffer_manager_for_mining::release_local_buffers_for_mining(local_buffers, context.num_partitions);
 			atomic_num_producers--;
 
 		}
 
 
 		void MPhase::collect_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue) {
+			// stage tuples per partition locally, publish them to the shared buffers in batches
+			local_buffer_for_mining ** local_buffers = buffer_manager_for_mining::get_local_buffers_for_mining(buffers_for_shuffle, context.num_partitions);
+
 			std::tuple<int, long, long> task_id (-1, -1, -1);
 
 			// pop from queue
@@ -1123,28 +1046,14 @@ namespace RStream {
 				long update_file_size = size_task;
 
 				// streaming updates
-				char * update_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
-				long real_io_size = get_real_io_size(IO_SIZE, sizeof_in_tuple);
-				int streaming_counter = update_file_size / real_io_size + 1;
-
+				stream_reader update_reader(fd_update, offset_task, update_file_size, get_real_io_size(IO_SIZE, sizeof_in_tuple));
+				char * update_local_buf = nullptr;
 				long valid_io_size = 0;
-//				long offset = 0;
-				long offset = offset_task;
 
 				// for all streaming updates
-				for(int counter = 0; counter < streaming_counter; counter++) {
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-						valid_io_size = update_file_size - real_io_size * (streaming_counter - 1);
-					else
-						valid_io_size = real_io_size;
-
+				while(update_reader.next(update_local_buf, valid_io_size)) {
 					assert(valid_io_size % sizeof_in_tuple == 0);
 
-					io_manager::read_from_file(fd_update, update_local_buf, valid_io_size, offset);
-					offset += valid_io_size;
-
 					// streaming updates in, do hash join
 					for(long pos = 0; pos < valid_io_size; pos += sizeof_in_tuple) {
 						// get an in_update_tuple
@@ -1155,21 +1064,25 @@ namespace RStream {
 						get_an_in_update(update_local_buf + pos, in_update_tuple);
 
 						if(!filter_collect(in_update_tuple)){
-							insert_tuple_to_buffer(partition_id, in_update_tuple, buffers_for_shuffle);
+							insert_tuple_to_buffer(partition_id, in_update_tuple, local_buffers);
 //							std::cerr << "remained: " << in_update_tuple << std::endl;
 						}
 					}
 				}
 
-				free(update_local_buf);
 				close(fd_update);
 			}
 
+			buffer_manager_for_mining::release_local_buffers_for_mining(local_buffers, context.num_partitions);
 			atomic_num_producers--;
 
 		}
 
 		void MPhase::init_producer(global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<int> * task_queue) {
+			// stage tuples per partition locally, publish them to the shared buffers in batches
+			local_buffer_for_mining ** local_buffers = buffer_manager_for_mining::get_local_buffers_for_mining(buffers_for_shuffle, context.num_partitions);
+			local_pattern_table patterns;
+
 			int partition_id = -1;
 
 			// pop from queue
@@ -1183,32 +1096,19 @@ namespace RStream {
 				long edge_file_size = io_manager::get_filesize(fd_edge);
 
 				// streaming edges
-				char * edge_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
 				int size_of_unit = context.edge_unit;
-				long real_io_size = get_real_io_size(IO_SIZE, size_of_unit);
-				int streaming_counter = edge_file_size / real_io_size + 1;
-
+				stream_reader edge_reader(fd_edge, 0, edge_file_size, get_real_io_size(IO_SIZE, size_of_unit));
+				char * edge_local_buf = nullptr;
 				long valid_io_size = 0;
-				long offset = 0;
 
 				// for all streaming
-				for(int counter = 0; counter < streaming_counter; counter++) {
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-						valid_io_size = edge_file_size - real_io_size * (streaming_counter - 1);
-					else
-						valid_io_size = real_io_size;
-
+				while(edge_reader.next(edge_local_buf, valid_io_size)) {
 //					std::cout << real_io_size << std::endl;
 //					std::cout << edge_file_size << std::endl;
 //					std::cout << size_of_unit << std::endl;
 //					std::cout << valid_io_size << std::endl;
 					assert(valid_io_size % size_of_unit == 0);
 
-					io_manager::read_from_file(fd_edge, edge_local_buf, valid_io_size, offset);
-					offset += valid_io_size;
-
 					// for each streaming
 					for(long pos = 0; pos < valid_io_size; pos += size_of_unit) {
 						// get an labeled edge
@@ -1218,22 +1118,122 @@ namespace RStream {
 						std::vector<Element_In_Tuple> out_update_tuple;
 						out_update_tuple.push_back(Element_In_Tuple(e.src, 0, e.src_label));
 						out_update_tuple.push_back(Element_In_Tuple(e.target, 0, e.target_label));
+						set_pattern_id(out_update_tuple, patterns.get_edge_pattern(e.src_label, e.target_label));
 
 						// shuffle on both src and target
 						if(!Pattern::is_automorphism_init(out_update_tuple)){
-							insert_tuple_to_buffer(partition_id, out_update_tuple, buffers_for_shuffle);
+							insert_tuple_to_buffer(partition_id, out_update_tuple, local_buffers);
 						}
 					}
 				}
 
-				free(edge_local_buf);
 				close(fd_edge);
 			}
 
+			buffer_manager_for_mining::release_local_buffers_for_mining(local_buffers, context.num_partitions);
+			atomic_num_producers--;
+		}
+
+		void MPhase::join_allkeys_nonshuffle_tuple_producer_clique_intersect(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, const edge_index * edges) {
+			// stage tuples per partition locally, publish them to the shared buffers in batches
+			local_buffer_for_mining ** local_buffers = buffer_manager_for_mining::get_local_buffers_for_mining(buffers_for_shuffle, context.num_partitions);
+
+			// neighbor ranges of the members above the last member, and the common neighbors found so far
+			std::vector<std::pair<const VertexId*, long>> ranges;
+			std::vector<VertexId> candidates, next_candidates;
+			// the intersection needs distinct ids: with parallel edges in the index, the ranges are deduplicated into these first
+			const bool parallel_edges = edges->has_parallel_edges();
+			std::vector<std::vector<VertexId>> distinct_ranges;
+
+			std::tuple<int, long, long> task_id (-1, -1, -1);
+
+			// pop from queue
+			while(task_queue->test_pop_atomic(task_id)){
+				int partition_id = std::get<0>(task_id);
+				long offset_task = std::get<1>(task_id);
+				long size_task = std::get<2>(task_id);
+				assert(partition_id != -1 && offset_task != -1 && size_task != -1);
+
+//				Logger::print_thread_info_locked("as a (join-all-keys-nonshuffle-tuple-clique-intersect) producer dealing with partition " + get_string_task_tuple(task_id) + "\n");
+
+				int fd_update = open((context.filename + "." + std::to_string(partition_id) + ".update_stream_" + std::to_string(in_update_stream)).c_str(), O_RDONLY);
+				assert(fd_update > 0);
+
+				long update_file_size = size_task;
+
+				// streaming updates
+				stream_reader update_reader(fd_update, offset_task, update_file_size, get_real_io_size(IO_SIZE, sizeof_in_tuple));
+				char * update_local_buf = nullptr;
+				long valid_io_size = 0;
+
+				// for all streaming updates
+				while(update_reader.next(update_local_buf, valid_io_size)) {
+					assert(valid_io_size % sizeof_in_tuple == 0);
+
+					for(long pos = 0; pos < valid_io_size; pos += sizeof_in_tuple) {
+						MTuple_join_simple in_update_tuple(sizeof_in_tuple);
+						get_an_in_update(update_local_buf + pos, in_update_tuple);
+
+						// members of a clique tuple are in increasing order, so only common neighbors above the last one extend it
+						unsigned int size = in_update_tuple.get_size();
+						VertexId last = in_update_tuple.at(size - 1).id;
+
+						ranges.clear();
+						if(parallel_edges && distinct_ranges.size() < size)
+							distinct_ranges.resize(size);
+						for(unsigned int i = 0; i < size; ++i){
+							VertexId id = in_update_tuple.at(i).id;
+							const VertexId * neighbors_end = edges->get_neighbors(id) + edges->get_degree(id);
+							const VertexId * above_last = std::upper_bound(edges->get_neighbors(id), neighbors_end, last);
+							if(parallel_edges) {
+								std::vector<VertexId> & distinct = distinct_ranges[i];
+								distinct.resize(neighbors_end - above_last);
+								distinct.resize(std::unique_copy(above_last, neighbors_end, distinct.begin()) - distinct.begin());
+								ranges.push_back(std::make_pair((const VertexId*)distinct.data(), (long)distinct.size()));
+							}
+							else {
+								ranges.push_back(std::make_pair(above_last, (long)(neighbors_end - above_last)));
+							}
+						}
+
+						// intersect from the shortest range up, so the candidates shrink as early as possible
+						std::sort(ranges.begin(), ranges.end(), [](const std::pair<const VertexId*, long> & a, const std::pair<const VertexId*, long> & b) { return a.second < b.second; });
+						if(ranges.front().second == 0)
+							continue;
+
+						candidates.assign(ranges.front().first, ranges.front().first + ranges.front().second);
+						long num_candidates = ranges.front().second;
+						for(unsigned int i = 1; i < ranges.size() && num_candidates > 0; ++i){
+							next_candidates.resize(num_candidates);
+							num_candidates = intersection::intersect(candidates.data(), num_candidates, ranges[i].first, ranges[i].second, next_candidates.data());
+							std::swap(candidates, next_candidates);
+						}
+
+						// every candidate closes a clique one larger, no aggregation round needed to confirm it
+						for(long k = 0; k < num_candidates; k++) {
+							Base_Element element(candidates[k]);
+							gen_an_out_update(in_update_tuple, element);
+
+							if(!filter_join_clique(in_update_tuple)){
+								shuffle(in_update_tuple, local_buffers, partition_id);
+							}
+
+							in_update_tuple.pop();
+						}
+					}
+				}
+
+				close(fd_update);
+			}
+
+			buffer_manager_for_mining::release_local_buffers_for_mining(local_buffers, context.num_partitions);
 			atomic_num_producers--;
 		}
 
 		void MPhase::init_clique_producer(global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<int> * task_queue) {
+			// stage tuples per partition locally, publish them to the shared buffers in batches
+			local_buffer_for_mining ** local_buffers = buffer_manager_for_mining::get_local_buffers_for_mining(buffers_for_shuffle, context.num_partitions);
+
 			int partition_id = -1;
 
 			// pop from queue
@@ -1247,32 +1247,19 @@ namespace RStream {
 				long edge_file_size = io_manager::get_filesize(fd_edge);
 
 				// streaming edges
-				char * edge_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
 				int size_of_unit = context.edge_unit;
-				long real_io_size = get_real_io_size(IO_SIZE, size_of_unit);
-				int streaming_counter = edge_file_size / real_io_size + 1;
-
+				stream_reader edge_reader(fd_edge, 0, edge_file_size, get_real_io_size(IO_SIZE, size_of_unit));
+				char * edge_local_buf = nullptr;
 				long valid_io_size = 0;
-				long offset = 0;
 
 				// for all streaming
-				for(int counter = 0; counter < streaming_counter; counter++) {
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-						valid_io_size = edge_file_size - real_io_size * (streaming_counter - 1);
-					else
-						valid_io_size = real_io_size;
-
+				while(edge_reader.next(edge_local_buf, valid_io_size)) {
 //					std::cout << real_io_size << std::endl;
 //					std::cout << edge_file_size << std::endl;
 //					std::cout << size_of_unit << std::endl;
 //					std::cout << valid_io_size << std::endl;
 					assert(valid_io_size % size_of_unit == 0);
 
-					io_manager::read_from_file(fd_edge, edge_local_buf, valid_io_size, offset);
-					offset += valid_io_size;
-
 					// for each streaming
 					for(long pos = 0; pos < valid_io_size; pos += size_of_unit) {
 						// get an labeled edge
@@ -1285,20 +1272,24 @@ namespace RStream {
 
 						// shuffle on both src and target
 						if(!Pattern::is_automorphism_init_clique(out_update_tuple)){
-							insert_tuple_to_buffer_clique(partition_id, out_update_tuple, buffers_for_shuffle);
+							insert_tuple_to_buffer_clique(partition_id, out_update_tuple, local_buffers);
 						}
 
 					}
 				}
 
-				free(edge_local_buf);
 				close(fd_edge);
 			}
 
+			buffer_manager_for_mining::release_local_buffers_for_mining(local_buffers, context.num_partitions);
 			atomic_num_producers--;
 		}
 
 		void MPhase::shuffle_all_keys_producer_init(global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<int> * task_queue) {
+			// stage tuples per partition locally, publish them to the shared buffers in batches
+			local_buffer_for_mining ** local_buffers = buffer_manager_for_mining::get_local_buffers_for_mining(buffers_for_shuffle, context.num_partitions);
+			local_pattern_table patterns;
+
 			int partition_id = -1;
 
 			// pop from queue
@@ -1313,31 +1304,18 @@ namespace RStream {
 
 				// streaming edges
 				int size_of_unit = context.edge_unit;
-				char * edge_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
-				long real_io_size = get_real_io_size(IO_SIZE, size_of_unit);
-				int streaming_counter = edge_file_size / real_io_size + 1;
-
+				stream_reader edge_reader(fd_edge, 0, edge_file_size, get_real_io_size(IO_SIZE, size_of_unit));
+				char * edge_local_buf = nullptr;
 				long valid_io_size = 0;
-				long offset = 0;
 
 				// for all streaming
-				for(int counter = 0; counter < streaming_counter; counter++) {
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-						valid_io_size = edge_file_size - real_io_size * (streaming_counter - 1);
-					else
-						valid_io_size = real_io_size;
-
+				while(edge_reader.next(edge_local_buf, valid_io_size)) {
 //					std::cout << real_io_size << std::endl;
 //					std::cout << edge_file_size << std::endl;
 //					std::cout << size_of_unit << std::endl;
 //					std::cout << valid_io_size << std::endl;
 					assert(valid_io_size % size_of_unit == 0);
 
-					io_manager::read_from_file(fd_edge, edge_local_buf, valid_io_size, offset);
-					offset += valid_io_size;
-
 					// for each streaming
 					for(long pos = 0; pos < valid_io_size; pos += size_of_unit) {
 						// get an labeled edge
@@ -1347,33 +1325,31 @@ namespace RStream {
 						std::vector<Element_In_Tuple> out_update_tuple;
 						out_update_tuple.push_back(Element_In_Tuple(e.src, 0, e.src_label));
 						out_update_tuple.push_back(Element_In_Tuple(e.target, 0, e.target_label));
+						set_pattern_id(out_update_tuple, patterns.get_edge_pattern(e.src_label, e.target_label));
 
 						// shuffle on both src and target
 						if(!Pattern::is_automorphism_init(out_update_tuple)){
-							shuffle_on_all_keys(out_update_tuple, buffers_for_shuffle);
+							shuffle_on_all_keys(out_update_tuple, local_buffers);
 						}
 
 					}
 				}
 
-				free(edge_local_buf);
 				close(fd_edge);
 			}
 
+			buffer_manager_for_mining::release_local_buffers_for_mining(local_buffers, context.num_partitions);
 			atomic_num_producers--;
 		}
 
 
 		// each writer thread generates a join_consumer
 		void MPhase::consumer(Update_Stream out_update_stream, global_buffer_for_mining ** buffers_for_shuffle) {
-			while(atomic_num_producers != 0) {
-				int i = (++atomic_partition_id) % context.num_partitions;
-
+			// flush the buffers producers report as full, until all producers are done
+			for(int i = -1; ready_partitions.pop(i); ) {
 				std::string file_name (context.filename + "." + std::to_string(i) + ".update_stream_" + std::to_string(out_update_stream));
 				global_buffer_for_mining* g_buf = buffer_manager_for_mining::get_global_buffer_for_mining(buffers_for_shuffle, context.num_partitions, i);
 				g_buf->flush(file_name, i);
-
-				atomic_partition_id = atomic_partition_id % context.num_partitions;
 			}
 
 			//the last run - deal with all remaining content in buffers
@@ -1393,62 +1369,78 @@ namespace RStream {
 			}
 		}
 
-		void MPhase::shuffle_on_all_keys(std::vector<Element_In_Tuple> & out_update_tuple, global_buffer_for_mining ** buffers_for_shuffle) {
-			std::unordered_set<VertexId> vertex_set;
+		void MPhase::shuffle_on_all_keys(std::vector<Element_In_Tuple> & out_update_tuple, local_buffer_for_mining ** local_buffers) {
+			Vertex_Set vertex_set;
 			// shuffle on all other keys
 			for(unsigned i = 0; i < out_update_tuple.size(); i++) {
 				VertexId key = out_update_tuple[i].vertex_id;
 
 				// check if vertex id exsited already
 				// DO NOT shuffle if vertex exsited
-				if(vertex_set.find(key) == vertex_set.end()){
-					vertex_set.insert(key);
-
+				if(vertex_set.insert(key)){
 					set_key_index(out_update_tuple, i);
 					char* out_update = reinterpret_cast<char*>(out_update_tuple.data());
 
 					int index = get_global_buffer_index(key);
-					global_buffer_for_mining* global_buf = buffer_manager_for_mining::get_global_buffer_for_mining(buffers_for_shuffle, context.num_partitions, index);
-					global_buf->insert(out_update);
+					local_buffer_for_mining* local_buf = buffer_manager_for_mining::get_local_buffer_for_mining(local_buffers, context.num_partitions, index);
+					local_buf->insert(out_update);
 
 				}
 			}
 		}
 
 
-		void MPhase::shuffle_on_all_keys(MTuple& out_update_tuple, global_buffer_for_mining ** buffers_for_shuffle) {
-			std::unordered_set<VertexId> vertex_set;
+		void MPhase::shuffle_on_all_keys(MTuple& out_update_tuple, local_buffer_for_mining ** local_buffers) {
+			Vertex_Set vertex_set;
 			// shuffle on all other keys
 			for(unsigned i = 0; i < out_update_tuple.get_size(); i++) {
 				VertexId key = out_update_tuple.at(i).vertex_id;
 
 				// check if vertex id exsited already
 				// DO NOT shuffle if vertex exsited
-				if(vertex_set.find(key) == vertex_set.end()){
-					vertex_set.insert(key);
-
+				if(vertex_set.insert(key)){
 					set_key_index(out_update_tuple, i);
 					char* out_update = reinterpret_cast<char*>(out_update_tuple.get_elements());
 
 					int index = get_global_buffer_index(key);
-					global_buffer_for_mining* global_buf = buffer_manager_for_mining::get_global_buffer_for_mining(buffers_for_shuffle, context.num_partitions, index);
-					global_buf->insert(out_update);
+					local_buffer_for_mining* local_buf = buffer_manager_for_mining::get_local_buffer_for_mining(local_buffers, context.num_partitions, index);
+					local_buf->insert(out_update);
 
 				}
 			}
 		}
 
-		void MPhase::shuffle(MTuple_join_simple& out_update_tuple, global_buffer_for_mining ** buffers_for_shuffle, int partition_id) {
+		void MPhase::shuffle_on_all_keys(MTuple_join& out_update_tuple, local_buffer_for_mining ** local_buffers) {
+			Vertex_Set vertex_set;
+			// shuffle on all other keys
+			for(unsigned i = 0; i < out_update_tuple.get_size(); i++) {
+				VertexId key = out_update_tuple.at(i).vertex_id;
+
+				// check if vertex id exsited already
+				// DO NOT shuffle if vertex exsited
+				if(vertex_set.insert(key)){
+					set_key_index(out_update_tuple, i);
+					char* out_elements = reinterpret_cast<char*>(out_update_tuple.get_elements());
+					char* out_added = reinterpret_cast<char*>(out_update_tuple.get_added_element());
+
+					int index = get_global_buffer_index(key);
+					local_buffer_for_mining* local_buf = buffer_manager_for_mining::get_local_buffer_for_mining(local_buffers, context.num_partitions, index);
+					local_buf->insert(out_elements, out_added);
+				}
+			}
+		}
+
+		void MPhase::shuffle(MTuple_join_simple& out_update_tuple, local_buffer_for_mining ** local_buffers, int partition_id) {
 			unsigned int hash = out_update_tuple.get_hash();
 			unsigned int index = hash % context.num_partitions;
-			global_buffer_for_mining* global_buf = buffer_manager_for_mining::get_global_buffer_for_mining(buffers_for_shuffle, context.num_partitions, index);
+			local_buffer_for_mining* local_buf = buffer_manager_for_mining::get_local_buffer_for_mining(local_buffers, context.num_partitions, index);
 
 //			global_buffer_for_mining* global_buf = buffer_manager_for_mining::get_global_buffer_for_mining(buffers_for_shuffle, context.num_partitions, partition_id);
 			char* out_update = reinterpret_cast<char*>(out_update_tuple.get_elements());
 			char* added = reinterpret_cast<char*>(out_update_tuple.get_added_element());
 //			std::cout << *((Base_Element*)out_update) << std::endl;
 //			std::cout << *((Base_Element*)added) << std::endl;
-			global_buf->insert_simple(out_update, added);
+			local_buf->insert_simple(out_update, added);
 
 		}
 
@@ -1457,10 +1449,10 @@ namespace RStream {
 			in_update_tuple.push(&element);
 		}
 
-		bool MPhase::gen_an_out_update(MTuple_join & in_update_tuple, Element_In_Tuple & element, BYTE history, std::unordered_set<VertexId>& vertices_set) {
+		bool MPhase::gen_an_out_update(MTuple_join & in_update_tuple, Element_In_Tuple & element, BYTE history, Vertex_Set& vertices_set) {
 			bool vertex_existed = true;
-			auto num_vertices = vertices_set.size();
-			if(vertices_set.find(element.vertex_id) == vertices_set.end()){
+			auto num_vertices = vertices_set.get_size();
+			if(!vertices_set.contains(element.vertex_id)){
 				num_vertices += 1;
 				vertex_existed = false;
 			}
@@ -1503,27 +1495,17 @@ namespace RStream {
 			out_update_tuple.at(0).key_index = new_key_index;
 		}
 
-		void MPhase::build_edge_hashmap(char * edge_buf, std::vector<Base_Element> * edge_hashmap, size_t edge_file_size, int start_vertex) {
-			// for each edge
-			for(size_t pos = 0; pos < edge_file_size; pos += context.edge_unit) {
-				// get a labeled edge
-				LabeledEdge e = *(LabeledEdge*)(edge_buf + pos);
-				// e.src is the key
-				if(e.src < e.target){
-					edge_hashmap[e.src - start_vertex].push_back(Base_Element(e.target));
-				}
+		void MPhase::set_pattern_id(std::vector<Element_In_Tuple> & out_update_tuple, unsigned int pattern_id) {
+			for(unsigned int i = 0; i < get_pattern_id_bytes(out_update_tuple.size()); ++i) {
+				out_update_tuple.at(i).edge_label = (BYTE)(pattern_id >> (8 * i));
 			}
 		}
 
-		// TODO: do we need to store src.label?
-		void MPhase::build_edge_hashmap(char * edge_buf, std::vector<Element_In_Tuple> * edge_hashmap, size_t edge_file_size, int start_vertex) {
-			// for each edge
-			for(size_t pos = 0; pos < edge_file_size; pos += context.edge_unit) {
-				// get a labeled edge
-				LabeledEdge e = *(LabeledEdge*)(edge_buf + pos);
-				// e.src is the key
-				edge_hashmap[e.src - start_vertex].push_back(Element_In_Tuple(e.target, (BYTE)0, e.target_label));
-			}
+		// the added element only depends on its history, on which vertex of the parent it is (if any) and on its label
+		void MPhase::set_pattern_id(MTuple_join & out_update_tuple, local_pattern_table & patterns, unsigned int parent_pattern, Vertex_Set & vertices_set) {
+			Element_In_Tuple* added = out_update_tuple.get_added_element();
+			BYTE vertex = (BYTE)(vertices_set.index_of(added->vertex_id) + 1);
+			out_update_tuple.set_pattern_id(patterns.extend(parent_pattern, added->history_info, vertex, added->vertex_label));
 		}
 
 		int MPhase::get_global_buffer_index(VertexId key) {
@@ -1539,6 +1521,10 @@ namespace RStream {
 			return update_tuple.get_num_vertices();
 		}
 
+		unsigned int MPhase::get_num_vertices(MTuple_join & update_tuple){
+			return update_tuple.get_num_vertices();
+		}
+
 }
 
 
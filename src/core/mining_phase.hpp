@@ -12,6 +12,8 @@
 #include "meta_info.hpp"
 #include "buffer_manager.hpp"
 #include "pattern.hpp"
+#include "pattern_table.hpp"
+#include "intersection.hpp"
 #include "../utility/Logger.hpp"
 
 
@@ -38,6 +40,9 @@ namespace RStream {
 		 */
 		Update_Stream join_all_keys_nonshuffle(Update_Stream in_update_stream);
 		Update_Stream join_all_keys_nonshuffle_clique(Update_Stream in_update_stream);
+		// extend every k-clique by the common neighbors of its members only, so the output holds exactly the (k+1)-cliques
+		// and needs no aggregate_filter_clique round
+		Update_Stream join_all_keys_nonshuffle_clique_intersect(Update_Stream in_update_stream);
 
 		/** join update stream with edge stream to generate non-shuffled update stream
 		 * @param in_update_stream: which is shuffled
@@ -147,7 +152,7 @@ namespace RStream {
 		}
 
 
-		static void get_an_in_update(char * update_local_buf, MTuple_join & tuple, std::unordered_set<VertexId>& vertices_set) {
+		static void get_an_in_update(char * update_local_buf, MTuple_join & tuple, Vertex_Set& vertices_set) {
 			tuple.init(update_local_buf, vertices_set);
 		}
 
@@ -177,6 +182,7 @@ namespace RStream {
 		unsigned int get_num_vertices(std::vector<Element_In_Tuple> & update_tuple);
 
 		unsigned int get_num_vertices(MTuple & update_tuple);
+		unsigned int get_num_vertices(MTuple_join & update_tuple);
 
 
 	private:
@@ -184,8 +190,6 @@ namespace RStream {
 
 		unsigned int get_count(Update_Stream in_update_stream);
 
-		void edges_loader(std::vector<Element_In_Tuple>* edge_hashmap, concurrent_queue<int> * read_task_queue);
-		void edges_loader(std::vector<Base_Element>* edge_hashmap, concurrent_queue<int> * read_task_queue);
 
 		// each exec thread generates a join producer
 		void join_all_keys_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue);
@@ -193,16 +197,17 @@ namespace RStream {
 //		// each exec thread generates a join producer
 //		void join_allkeys_nonshuffle_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, std::vector<Element_In_Tuple> * edge_hashmap);
 
-		void join_allkeys_nonshuffle_tuple_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, std::vector<Element_In_Tuple> * edge_hashmap);
-		void join_allkeys_nonshuffle_tuple_producer_clique(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, std::vector<Base_Element> * edge_hashmap);
+		void join_allkeys_nonshuffle_tuple_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, const edge_index * edges);
+		void join_allkeys_nonshuffle_tuple_producer_clique(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, const edge_index * edges);
+		void join_allkeys_nonshuffle_tuple_producer_clique_intersect(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, const edge_index * edges);
 
 		// each exec thread generates a join producer
 		void join_mining_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue);
 
-		void insert_tuple_to_buffer(int partition_id, std::vector<Element_In_Tuple>& in_update_tuple, global_buffer_for_mining** buffers_for_shuffle);
-		void insert_tuple_to_buffer(int partition_id, MTuple_join& in_update_tuple, global_buffer_for_mining** buffers_for_shuffle);
-		void insert_tuple_to_buffer(int partition_id, MTuple& in_update_tuple, global_buffer_for_mining** buffers_for_shuffle);
-		void insert_tuple_to_buffer_clique(int partition_id, std::vector<Base_Element>& in_update_tuple, global_buffer_for_mining** buffers_for_shuffle);
+		void insert_tuple_to_buffer(int partition_id, std::vector<Element_In_Tuple>& in_update_tuple, local_buffer_for_mining ** local_buffers);
+		void insert_tuple_to_buffer(int partition_id, MTuple_join& in_update_tuple, local_buffer_for_mining ** local_buffers);
+		void insert_tuple_to_buffer(int partition_id, MTuple& in_update_tuple, local_buffer_for_mining ** local_buffers);
+		void insert_tuple_to_buffer_clique(int partition_id, std::vector<Base_Element>& in_update_tuple, local_buffer_for_mining ** local_buffers);
 
 		void shuffle_all_keys_producer(Update_Stream in_update_stream, global_buffer_for_mining ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue);
 
@@ -216,12 +221,13 @@ namespace RStream {
 		// each writer thread generates a join_consumer
 		void consumer(Update_Stream out_update_stream, global_buffer_for_mining ** buffers_for_shuffle);
 
-		void shuffle_on_all_keys(std::vector<Element_In_Tuple> & out_update_tuple, global_buffer_for_mining ** buffers_for_shuffle);
-		void shuffle_on_all_keys(MTuple & out_update_tuple, global_buffer_for_mining ** buffers_for_shuffle);
-		void shuffle(MTuple_join_simple& out_update_tuple, global_buffer_for_mining ** buffers_for_shuffle, int partition_id);
+		void shuffle_on_all_keys(std::vector<Element_In_Tuple> & out_update_tuple, local_buffer_for_mining ** local_buffers);
+		void shuffle_on_all_keys(MTuple & out_update_tuple, local_buffer_for_mining ** local_buffers);
+		void shuffle_on_all_keys(MTuple_join & out_update_tuple, local_buffer_for_mining ** local_buffers);
+		void shuffle(MTuple_join_simple& out_update_tuple, local_buffer_for_mining ** local_buffers, int partition_id);
 
 		bool gen_an_out_update(std::vector<Element_In_Tuple> & in_update_tuple, Element_In_Tuple & element, BYTE history, std::unordered_set<VertexId>& vertices_set);
-		bool gen_an_out_update(MTuple_join & in_update_tuple, Element_In_Tuple & element, BYTE history, std::unordered_set<VertexId>& vertices_set);
+		bool gen_an_out_update(MTuple_join & in_update_tuple, Element_In_Tuple & element, BYTE history, Vertex_Set& vertices_set);
 		void gen_an_out_update(MTuple_join_simple & in_update_tuple, Base_Element & element);
 
 		// key index is always stored in the first element of the vector
@@ -231,9 +237,11 @@ namespace RStream {
 		void set_key_index(std::vector<Element_In_Tuple> & out_update_tuple, int new_key_index);
 		void set_key_index(MTuple & out_update_tuple, int new_key_index);
 
+		// pattern id of an init tuple, or of a joined tuple derived from the id of the tuple it extends
+		void set_pattern_id(std::vector<Element_In_Tuple> & out_update_tuple, unsigned int pattern_id);
+		void set_pattern_id(MTuple_join & out_update_tuple, local_pattern_table & patterns, unsigned int parent_pattern, Vertex_Set & vertices_set);
+
 		// TODO: do we need to store src.label?
-		void build_edge_hashmap(char * edge_buf, std::vector<Element_In_Tuple> * edge_hashmap, size_t edge_file_size, int start_vertex);
-		void build_edge_hashmap(char * edge_buf, std::vector<Base_Element> * edge_hashmap, size_t edge_file_size, int start_vertex);
 
 		int get_global_buffer_index(VertexId key);
 
@@ -251,6 +259,8 @@ namespace RStream {
 		std::atomic<int> atomic_num_producers;
 		std::atomic<int> atomic_partition_id;
 		std::atomic<int> atomic_partition_number;
+		// ids of shuffle buffers ready to be flushed, consumed by the writer threads
+		blocking_queue<int> ready_partitions;
 
 		// num of bytes for in_update_tuple
 		unsigned int sizeof_in_tuple;
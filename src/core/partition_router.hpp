@@ -0,0 +1,65 @@
+/*
+ * partition_router.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ */
+
+#ifndef CORE_PARTITION_ROUTER_HPP_
+#define CORE_PARTITION_ROUTER_HPP_
+
+#include "../common/RStreamCommon.hpp"
+#include "../struct/type.hpp"
+#include "constants.hpp"
+
+namespace RStream {
+
+	// partition of a vertex id in constant time, for contiguous vertex intervals of any lengths, equal or edge balanced.
+	// ids are cut into blocks of 2^shift ids, no longer than the shortest interval unless the table would exceed
+	// MAX_ROUTING_BLOCKS entries. a block keeps the partition of its first id, so an id only steps over the
+	// interval ends inside its block, at most one.
+	class partition_router {
+		int shift;
+		std::vector<int> block_partitions;
+		std::vector<VertexId> interval_ends;
+
+	public:
+		partition_router() : shift(0) {}
+
+		void build(const std::vector<std::pair<VertexId, VertexId>> & intervals) {
+			assert(!intervals.empty() && intervals.front().first == 0);
+
+			interval_ends.clear();
+			long min_length = LONG_MAX;
+			for(unsigned int i = 0; i < intervals.size(); i++) {
+				assert(i == 0 || intervals[i].first == intervals[i - 1].second + 1);
+				interval_ends.push_back(intervals[i].second);
+				min_length = std::min(min_length, std::max((long)intervals[i].second - intervals[i].first + 1, 1L));
+			}
+
+			const long num_vertices = std::max((long)intervals.back().second + 1, 1L);
+			shift = 0;
+			while((1L << (shift + 1)) <= min_length || (num_vertices >> shift) > MAX_ROUTING_BLOCKS)
+				shift++;
+
+			long num_blocks = ((num_vertices - 1) >> shift) + 1;
+			block_partitions.resize(num_blocks);
+			int partition_id = 0;
+			for(long block = 0; block < num_blocks; block++) {
+				while(partition_id < (int)interval_ends.size() - 1 && (block << shift) > interval_ends[partition_id])
+					partition_id++;
+				block_partitions[block] = partition_id;
+			}
+		}
+
+		inline int get_index(VertexId id) const {
+			int partition_id = block_partitions[id >> shift];
+			while(id > interval_ends[partition_id])
+				partition_id++;
+			return partition_id;
+		}
+	};
+
+}
+
+#endif /* CORE_PARTITION_ROUTER_HPP_ */
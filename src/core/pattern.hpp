@@ -11,6 +11,7 @@
 #include "../struct/quick_pattern.hpp"
 #include "../struct/canonical_graph.hpp"
 #include "../struct/mining_tuple.hpp"
+#include "canonical_table.hpp"
 
 namespace RStream {
 
@@ -47,6 +48,11 @@ public:
 	}
 
 	static Canonical_Graph* turn_canonical_graph(Quick_Pattern & sub_graph, const bool is_directed){
+		// small patterns are labeled from a precomputed table, bliss only handles the larger ones
+		if(!is_directed && canonical_table::get_num_vertices(sub_graph) <= canonical_table::MAX_VERTICES){
+			return canonical_table::get_instance().turn_canonical_graph(sub_graph);
+		}
+
 		bliss::AbstractGraph* cf_bliss = turn_canonical_graph_bliss(sub_graph, is_directed);
 //		std::cout << "done bliss." << std::endl;
 		Canonical_Graph* cf = new Canonical_Graph(cf_bliss, is_directed);
@@ -257,6 +263,8 @@ public:
 			if(!label_flag){
 				element.vertex_label = (BYTE)0;
 			}
+			// edge label bytes hold the pattern id of the tuple
+			element.edge_label = (BYTE)0;
 
 			VertexId old_id = element.vertex_id;
 			auto iterator = map.find(old_id);
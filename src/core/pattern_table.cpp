@@ -0,0 +1,94 @@
+/*
+ * pattern_table.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ */
+
+#include "pattern_table.hpp"
+
+namespace RStream {
+
+		pattern_table & pattern_table::get_instance() {
+			static pattern_table table;
+			return table;
+		}
+
+		pattern_table::pattern_table() {
+
+		}
+
+		unsigned int pattern_table::get_edge_pattern(BYTE src_label, BYTE target_label) {
+			unsigned int key = ((unsigned int)src_label << 8) | target_label;
+
+			std::unique_lock<std::mutex> lock(mutex);
+			auto it = edge_patterns.find(key);
+			if(it != edge_patterns.end())
+				return it->second;
+
+			// same elements as the init tuple, with its vertices renamed 1 and 2
+			Quick_Pattern pattern(2 * sizeof(Element_In_Tuple));
+			pattern.at(0) = Element_In_Tuple(1, (BYTE)0, (BYTE)0, src_label, (BYTE)0);
+			pattern.at(1) = Element_In_Tuple(2, (BYTE)0, (BYTE)0, target_label, (BYTE)0);
+
+			unsigned int id = add_pattern(pattern);
+			edge_patterns.insert(std::make_pair(key, id));
+			return id;
+		}
+
+		unsigned int pattern_table::extend(unsigned int parent, BYTE history, BYTE vertex, BYTE vertex_label) {
+			unsigned long long key = get_transition_key(parent, history, vertex, vertex_label);
+
+			std::unique_lock<std::mutex> lock(mutex);
+			auto it = transitions.find(key);
+			if(it != transitions.end())
+				return it->second;
+
+			assert(parent < patterns.size());
+			const Quick_Pattern & parent_pattern = patterns[parent];
+			unsigned int size = parent_pattern.get_size();
+			assert(size < Quick_Pattern::MAX_SIZE && history < size);
+
+			VertexId num_vertices = 0;
+			for(unsigned int index = 0; index < size; ++index) {
+				num_vertices = std::max(num_vertices, parent_pattern.at(index).vertex_id);
+			}
+
+			// the join stores the number of vertices of the tuple in the key index of the added element
+			Quick_Pattern pattern((size + 1) * sizeof(Element_In_Tuple));
+			std::copy(&parent_pattern.at(0), &parent_pattern.at(0) + size, pattern.get_elements());
+			if(vertex == 0) {
+				pattern.at(size) = Element_In_Tuple(num_vertices + 1, (BYTE)(num_vertices + 1), (BYTE)0, vertex_label, history);
+			}
+			else {
+				assert((VertexId)vertex <= num_vertices);
+				pattern.at(size) = Element_In_Tuple(vertex, (BYTE)num_vertices, (BYTE)0, vertex_label, history);
+			}
+
+			unsigned int id = add_pattern(pattern);
+			transitions.insert(std::make_pair(key, id));
+			return id;
+		}
+
+		Quick_Pattern pattern_table::get_pattern(unsigned int id) {
+			std::unique_lock<std::mutex> lock(mutex);
+			assert(id < patterns.size());
+			return patterns[id];
+		}
+
+		unsigned int pattern_table::get_num_patterns() {
+			std::unique_lock<std::mutex> lock(mutex);
+			return patterns.size();
+		}
+
+		unsigned int pattern_table::add_pattern(const Quick_Pattern & pattern) {
+			unsigned int id = patterns.size();
+			// the id has to fit in the bytes a tuple of this size keeps it in
+			unsigned int id_bytes = get_pattern_id_bytes(pattern.get_size());
+			assert(id_bytes >= sizeof(unsigned int) || id < (1u << (8 * id_bytes)));
+
+			patterns.push_back(pattern);
+			return id;
+		}
+
+}
@@ -0,0 +1,85 @@
+/*
+ * pattern_table.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ */
+
+#ifndef CORE_PATTERN_TABLE_HPP_
+#define CORE_PATTERN_TABLE_HPP_
+
+#include "../struct/quick_pattern.hpp"
+
+namespace RStream {
+
+	// ids of the quick patterns of mining tuples, shared by the whole process.
+	// a tuple's quick pattern only depends on its parent's and on the element the join added to it,
+	// so the join derives the id of every new tuple from a transition (parent id, added element)
+	// and aggregation never has to rebuild quick patterns from tuples.
+	// quick patterns here keep vertex labels, aggregation drops them if it does not need them.
+	class pattern_table {
+	public:
+		static pattern_table & get_instance();
+
+		// pattern of the tuple of a single edge
+		unsigned int get_edge_pattern(BYTE src_label, BYTE target_label);
+
+		// pattern of a tuple of pattern parent, extended by an edge from its element history to
+		// its vertex number vertex (numbered from 1 in order of appearance), or to a new vertex if vertex is 0
+		unsigned int extend(unsigned int parent, BYTE history, BYTE vertex, BYTE vertex_label);
+
+		Quick_Pattern get_pattern(unsigned int id);
+
+		unsigned int get_num_patterns();
+
+		static inline unsigned long long get_transition_key(unsigned int parent, BYTE history, BYTE vertex, BYTE vertex_label) {
+			return ((unsigned long long)parent << 24) | ((unsigned long long)history << 16) | ((unsigned long long)vertex << 8) | vertex_label;
+		}
+
+	private:
+		std::mutex mutex;
+		std::vector<Quick_Pattern> patterns;
+		std::unordered_map<unsigned int, unsigned int> edge_patterns;
+		std::unordered_map<unsigned long long, unsigned int> transitions;
+
+		pattern_table();
+
+		unsigned int add_pattern(const Quick_Pattern & pattern);
+	};
+
+	// per-thread copy of the patterns already looked up, so the init and the join only lock the shared table
+	// the first time a thread meets a transition
+	class local_pattern_table {
+		pattern_table & table;
+		std::unordered_map<unsigned int, unsigned int> edge_patterns;
+		std::unordered_map<unsigned long long, unsigned int> transitions;
+
+	public:
+		local_pattern_table() : table(pattern_table::get_instance()) {}
+
+		inline unsigned int get_edge_pattern(BYTE src_label, BYTE target_label) {
+			unsigned int key = ((unsigned int)src_label << 8) | target_label;
+			auto it = edge_patterns.find(key);
+			if(it != edge_patterns.end())
+				return it->second;
+
+			unsigned int id = table.get_edge_pattern(src_label, target_label);
+			edge_patterns.insert(std::make_pair(key, id));
+			return id;
+		}
+
+		inline unsigned int extend(unsigned int parent, BYTE history, BYTE vertex, BYTE vertex_label) {
+			unsigned long long key = pattern_table::get_transition_key(parent, history, vertex, vertex_label);
+			auto it = transitions.find(key);
+			if(it != transitions.end())
+				return it->second;
+
+			unsigned int id = table.extend(parent, history, vertex, vertex_label);
+			transitions.insert(std::make_pair(key, id));
+			return id;
+		}
+	};
+
+}
+
+#endif /* CORE_PATTERN_TABLE_HPP_ */
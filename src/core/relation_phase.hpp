@@ -9,6 +9,7 @@
 #define CORE_RELATION_PHASE_HPP_
 
 #include "scatter.hpp"
+#include "external_sort.hpp"
 
 namespace RStream {
 	template<typename InUpdateType, typename OutUpdateType>
@@ -27,6 +28,12 @@ namespace RStream {
 		std::atomic<int> atomic_num_producers;
 //		std::atomic<int> atomic_partition_id;
 		std::atomic<int> atomic_partition_number;
+		// ids of shuffle buffers ready to be flushed, consumed by the writer threads
+		blocking_queue<int> ready_partitions;
+		// edge partitions sorted on src for the sort-merge join, prepared on first use and kept across joins
+		std::vector<std::string> sorted_edge_files;
+		// optional prebuilt, read-only index of all edge partitions, joined against instead of the partition files
+		const edge_index * edges;
 
 	public:
 //		struct JoinResultType {
@@ -40,15 +47,23 @@ namespace RStream {
 //		virtual bool filter(InUpdateType * update, Edge * edge) = 0;
 //		virtual OutUpdateType * project_columns(InUpdateType * in_update, Edge * edge) = 0;
 		virtual bool filter(InUpdateType * update, VertexId edge_src, VertexId edge_dst) = 0;
-		virtual OutUpdateType * project_columns(InUpdateType * in_update, VertexId edge_src, VertexId edge_dst) = 0;
+//		virtual OutUpdateType * project_columns(InUpdateType * in_update, VertexId edge_src, VertexId edge_dst) = 0;
+		// fill in the join result in place, out_update is a slot reused for every join output
+		virtual void project_columns(InUpdateType * in_update, VertexId edge_src, VertexId edge_dst, OutUpdateType & out_update) = 0;
 
 //		virtual int new_key();
 
-		RPhase(Engine & e) : context(e) {}
+		RPhase(Engine & e) : context(e), sorted_edge_files(e.num_partitions), edges(nullptr) {}
+
+		// joins probe the shared edge index (e.g. Engine::get_edge_index) directly, so no chunk task of any join
+		// re-reads its edge partition or rebuilds a hashmap of it. worth it for repeated joins on the same edges,
+		// like the iterations of a fixpoint.
+		RPhase(Engine & e, const edge_index * _edges) : context(e), sorted_edge_files(e.num_partitions), edges(_edges) {}
 
 		void atomic_init() {
 			atomic_num_producers = context.num_exec_threads;
 			atomic_partition_number = context.num_partitions;
+			ready_partitions.reset();
 		}
 
 		virtual ~RPhase() {}
@@ -56,10 +71,19 @@ namespace RStream {
 		/* join update stream with edge stream
 		 * @param in_update_stream -input file for update stream
 		 * @param out_update_stream -output file for update stream
+		 * with an edge index updates probe it, otherwise a partition is hash joined if its edges and hashmap fit in JOIN_MEMORY_BUDGET,
+		 * sort-merge joined if not
 		 * */
 		Update_Stream join(Update_Stream in_update_stream) {
 			atomic_init();
 
+			std::vector<bool> sort_merge(context.num_partitions, false);
+			for(int partition_id = 0; partition_id < context.num_partitions && !edges; partition_id++) {
+				sort_merge[partition_id] = get_hash_join_memory(partition_id) > JOIN_MEMORY_BUDGET;
+				if(sort_merge[partition_id])
+					prepare_sorted_edges(partition_id);
+			}
+
 //			Logger::print_thread_info_locked("--------------------Start Join Phase--------------------\n\n");
 
 			Update_Stream update_c = Engine::update_count++;
@@ -104,12 +128,12 @@ namespace RStream {
 			}
 
 			// allocate global buffers for shuffling
-			global_buffer<OutUpdateType> ** buffers_for_shuffle = buffer_manager<OutUpdateType>::get_global_buffers(context.num_partitions);
+			global_buffer<OutUpdateType> ** buffers_for_shuffle = buffer_manager<OutUpdateType>::get_global_buffers(context.num_partitions, &ready_partitions);
 
 			// exec threads will produce updates and push into shuffle buffers
 			std::vector<std::thread> exec_threads;
 			for(int i = 0; i < context.num_exec_threads; i++)
-				exec_threads.push_back( std::thread([=] { this->join_producer(in_update_stream, buffers_for_shuffle, task_queue); } ));
+				exec_threads.push_back( std::thread([=] { this->join_producer(in_update_stream, buffers_for_shuffle, task_queue, sort_merge); } ));
 
 			// write threads will flush shuffle buffer to update out stream file as long as it's full
 			std::vector<std::thread> write_threads;
@@ -120,6 +144,9 @@ namespace RStream {
 			for(auto & t : exec_threads)
 				t.join();
 
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
 			for(auto &t : write_threads)
 				t.join();
 
@@ -133,10 +160,10 @@ namespace RStream {
 
 		/* compute set difference for the two update_stream
 		 * result = update_stream1 - update_stream2
+		 * both are sorted per partition with bounded memory (see sorted_stream) and merged,
+		 * updates of update_stream1 keep their multiplicity
 		 * */
 		Update_Stream set_difference(Update_Stream update_stream1, Update_Stream update_stream2) {
-			atomic_init();
-
 //			Logger::print_thread_info_locked("--------------------Start Set Difference Phase--------------------\n\n");
 
 			Update_Stream update_c = Engine::update_count++;
@@ -148,26 +175,15 @@ namespace RStream {
 //				std::cout << partition_id << std::endl;
 			}
 
-			global_buffer<OutUpdateType> ** buffers = buffer_manager<OutUpdateType>::get_global_buffers(context.num_partitions);
-
-			// exec threads will produce updates and push into shuffle buffers
+			// every partition only produces its own output, no shuffling needed
 			std::vector<std::thread> exec_threads;
 			for(int i = 0; i < context.num_exec_threads; i++)
-				exec_threads.push_back( std::thread([=] { this->set_difference_producer(update_stream1, update_stream2, buffers, task_queue); } ));
-
-			// write threads will flush buffer to update out stream file as long as it's full
-			std::vector<std::thread> write_threads;
-			for(int i = 0; i < context.num_write_threads; i++)
-				write_threads.push_back(std::thread(&RPhase::set_difference_consumer, this, update_c, buffers));
+				exec_threads.push_back( std::thread([=] { this->set_difference_worker(update_stream1, update_stream2, update_c, task_queue); } ));
 
 			// join all threads
 			for(auto & t : exec_threads)
 				t.join();
 
-			for(auto &t : write_threads)
-				t.join();
-
-			delete[] buffers;
 			delete task_queue;
 
 //			Logger::print_thread_info_locked("--------------------Finish Set Difference Phase--------------------\n\n");
@@ -199,6 +215,7 @@ namespace RStream {
 
 		}
 
+		// sorts every partition with bounded memory (see sorted_stream) and keeps one update of every run of equal ones
 		Update_Stream remove_dup(Update_Stream update_stream) {
 //			Logger::print_thread_info_locked("--------------------Start Remove Duplicates Phase--------------------\n\n");
 
@@ -227,7 +244,12 @@ namespace RStream {
 	private:
 		// each exec thread generates a join producer
 //		void join_producer(Update_Stream in_update_stream, global_buffer<OutUpdateType> ** buffers_for_shuffle, concurrent_queue<int> * task_queue) {
-		void join_producer(Update_Stream in_update_stream, global_buffer<OutUpdateType> ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue) {
+		void join_producer(Update_Stream in_update_stream, global_buffer<OutUpdateType> ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue, const std::vector<bool> & sort_merge) {
+			// stage updates per partition locally, publish them to the shared buffers in batches
+			local_buffer<OutUpdateType> ** local_buffers = buffer_manager<OutUpdateType>::get_local_buffers(buffers_for_shuffle, context.num_partitions);
+			// slot project_columns writes each join result into
+			OutUpdateType out_update;
+
 //			atomic_num_producers++;
 			int partition_id = -1;
 			long chunk_offset = 0, chunk_size = 0;
@@ -244,6 +266,16 @@ namespace RStream {
 				chunk_offset = std::get<1>(one_task);
 				chunk_size = std::get<2>(one_task);
 
+				if(edges) {
+					index_join(in_update_stream, partition_id, chunk_offset, chunk_size, local_buffers, out_update);
+					continue;
+				}
+
+				if(sort_merge[partition_id]) {
+					sort_merge_join(in_update_stream, partition_id, chunk_offset, chunk_size, local_buffers, out_update);
+					continue;
+				}
+
 				int fd_update = open((context.filename + "." + std::to_string(partition_id) + ".update_stream_" + std::to_string(in_update_stream)).c_str(), O_RDONLY);
 				int fd_edge = open((context.filename + "." + std::to_string(partition_id)).c_str(), O_RDONLY);
 				assert(fd_update > 0 && fd_edge > 0 );
@@ -329,20 +361,18 @@ namespace RStream {
 								//TODO: generate join result
 //								char* join_result = reinterpret_cast<char*>(&update);
 //								OutUpdateType * out_update = project_columns(update, e);
-								OutUpdateType * out_update = project_columns(update, update->target, target);
+								project_columns(update, update->target, target, out_update);
 //								std::cout << *e << std::endl;
 //								std::cout << *update << std::endl;
 //								std::cout << *out_update << std::endl;
 
 								// insert into shuffle buffer accordingly
 //								int index = get_global_buffer_index(out_update);
-								int index = meta_info::get_index(out_update->target, context);
+								int index = meta_info::get_index(out_update.target, context);
 								assert(index >= 0);
 
-								global_buffer<OutUpdateType>* global_buf = buffer_manager<OutUpdateType>::get_global_buffer(buffers_for_shuffle, context.num_partitions, index);
-								global_buf->insert(out_update, index);
-
-								delete out_update;
+								local_buffer<OutUpdateType>* local_buf = buffer_manager<OutUpdateType>::get_local_buffer(local_buffers, context.num_partitions, index);
+								local_buf->insert(&out_update);
 
 							}
 //							delete e;
@@ -387,24 +417,212 @@ namespace RStream {
 				close(fd_edge);
 			}
 
+			buffer_manager<OutUpdateType>::release_local_buffers(local_buffers, context.num_partitions);
 			atomic_num_producers--;
 		}
 
+		// join of a chunk of updates with the out-edges of their targets in the edge index
+		void index_join(Update_Stream in_update_stream, int partition_id, long chunk_offset, long chunk_size, local_buffer<OutUpdateType> ** local_buffers, OutUpdateType & out_update) {
+			int fd_update = open(get_update_stream_file(partition_id, in_update_stream).c_str(), O_RDONLY);
+			assert(fd_update > 0);
+
+			{
+				stream_reader update_reader(fd_update, chunk_offset, chunk_size, IO_SIZE / sizeof(InUpdateType) * sizeof(InUpdateType));
+				char * update_local_buf = nullptr;
+				long valid_io_size = 0;
+				while(update_reader.next(update_local_buf, valid_io_size)) {
+					assert(valid_io_size % sizeof(InUpdateType) == 0);
+
+					for(long pos = 0; pos < valid_io_size; pos += sizeof(InUpdateType)) {
+						InUpdateType * update = (InUpdateType*)(update_local_buf + pos);
+
+						// update.target is edge.src
+						for(long k = edges->begin(update->target); k < edges->end(update->target); k++) {
+							VertexId target = edges->neighbor(k);
+							if(!filter(update, update->target, target)) {
+								project_columns(update, update->target, target, out_update);
+
+								int index = meta_info::get_index(out_update.target, context);
+								assert(index >= 0);
+
+								local_buffer<OutUpdateType>* local_buf = buffer_manager<OutUpdateType>::get_local_buffer(local_buffers, context.num_partitions, index);
+								local_buf->insert(&out_update);
+							}
+						}
+					}
+				}
+			}
+
+			close(fd_update);
+		}
+
+		// sort-merge join of a chunk of updates with its edge partition: the updates are sorted on target and the src-sorted
+		// edges streamed alongside, so neither has to fit in memory
+		void sort_merge_join(Update_Stream in_update_stream, int partition_id, long chunk_offset, long chunk_size, local_buffer<OutUpdateType> ** local_buffers, OutUpdateType & out_update) {
+			sorted_stream<InUpdateType, target_order<InUpdateType>> updates(get_update_stream_file(partition_id, in_update_stream), chunk_offset, chunk_size, SORT_MEMORY_BUDGET);
+
+			const int edge_unit = context.edge_unit;
+			int fd_edge = open(sorted_edge_files[partition_id].c_str(), O_RDONLY);
+			assert(fd_edge > 0);
+
+			{
+				stream_reader edge_reader(fd_edge, 0, io_manager::get_filesize(fd_edge), IO_SIZE / edge_unit * edge_unit);
+				char * edge_local_buf = nullptr;
+				long valid_io_size = 0, pos = 0;
+				Edge edge;
+				auto next_edge = [&]() -> bool {
+					if(pos == valid_io_size) {
+						if(!edge_reader.next(edge_local_buf, valid_io_size))
+							return false;
+						pos = 0;
+					}
+					edge = *(Edge*)(edge_local_buf + pos);
+					pos += edge_unit;
+					return true;
+				};
+				bool has_edge = next_edge();
+
+				// targets of the edges of the current key, shared by all updates on it
+				std::vector<VertexId> targets;
+				VertexId key = 0;
+				bool has_key = false;
+
+				InUpdateType update;
+				while(updates.next(update)) {
+					if(!has_key || update.target != key) {
+						key = update.target;
+						has_key = true;
+						targets.clear();
+
+						while(has_edge && edge.src < key)
+							has_edge = next_edge();
+						while(has_edge && edge.src == key) {
+							targets.push_back(edge.target);
+							has_edge = next_edge();
+						}
+					}
+
+					for(VertexId target : targets) {
+						if(!filter(&update, update.target, target)) {
+							project_columns(&update, update.target, target, out_update);
+
+							int index = meta_info::get_index(out_update.target, context);
+							assert(index >= 0);
+
+							local_buffer<OutUpdateType>* local_buf = buffer_manager<OutUpdateType>::get_local_buffer(local_buffers, context.num_partitions, index);
+							local_buf->insert(&out_update);
+						}
+					}
+				}
+			}
+
+			close(fd_edge);
+		}
+
+		// the hash join keeps a whole edge partition and its hashmap in memory
+		long get_hash_join_memory(int partition_id) {
+			long edge_file_size = get_file_size(get_edge_file(partition_id));
+
+			long n_vertices = context.vertex_intervals[partition_id].second - context.vertex_intervals[partition_id].first + 1;
+			return edge_file_size + edge_file_size / context.edge_unit * sizeof(VertexId) + n_vertices * sizeof(std::vector<VertexId>);
+		}
+
+		// partitions are normally written sorted on src already, then they are used as they are.
+		// otherwise a sorted copy is written next to the partition, shared by all RPhases of the engine until Engine::clean_files
+		void prepare_sorted_edges(int partition_id) {
+			if(!sorted_edge_files[partition_id].empty())
+				return;
+
+			const std::string edge_file = get_edge_file(partition_id);
+			if(is_sorted_on_src(edge_file)) {
+				sorted_edge_files[partition_id] = edge_file;
+				return;
+			}
+
+			const std::string sorted_edge_file = Engine::get_sorted_edge_file(context.filename, partition_id);
+			// a copy left by an earlier run is reused only if it was written after the partition, and in full
+			if(FileUtil::file_exists(sorted_edge_file) && is_newer(sorted_edge_file, edge_file) && get_file_size(sorted_edge_file) == get_file_size(edge_file)) {
+				sorted_edge_files[partition_id] = sorted_edge_file;
+				return;
+			}
+
+			if(context.edge_unit == sizeof(Edge))
+				sort_edges<Edge>(edge_file, sorted_edge_file);
+			else if(context.edge_unit == sizeof(WeightedEdge))
+				sort_edges<WeightedEdge>(edge_file, sorted_edge_file);
+			else {
+				assert(context.edge_unit == sizeof(LabeledEdge));
+				sort_edges<LabeledEdge>(edge_file, sorted_edge_file);
+			}
+			sorted_edge_files[partition_id] = sorted_edge_file;
+		}
+
+		long get_file_size(const std::string & file_name) {
+			int fd = open(file_name.c_str(), O_RDONLY);
+			assert(fd > 0);
+			long file_size = io_manager::get_filesize(fd);
+			close(fd);
+			return file_size;
+		}
+
+		static bool is_newer(const std::string & file_name, const std::string & than_file_name) {
+			struct stat file_stat, than_stat;
+			if(stat(file_name.c_str(), &file_stat) != 0 || stat(than_file_name.c_str(), &than_stat) != 0)
+				return false;
+			if(file_stat.st_mtim.tv_sec != than_stat.st_mtim.tv_sec)
+				return file_stat.st_mtim.tv_sec > than_stat.st_mtim.tv_sec;
+			return file_stat.st_mtim.tv_nsec >= than_stat.st_mtim.tv_nsec;
+		}
+
+		bool is_sorted_on_src(const std::string & edge_file) {
+			const int edge_unit = context.edge_unit;
+			int fd_edge = open(edge_file.c_str(), O_RDONLY);
+			assert(fd_edge > 0);
+
+			bool sorted = true;
+			{
+				stream_reader edge_reader(fd_edge, 0, io_manager::get_filesize(fd_edge), IO_SIZE / edge_unit * edge_unit);
+				char * edge_local_buf = nullptr;
+				long valid_io_size = 0;
+				VertexId last_src = 0;
+				while(sorted && edge_reader.next(edge_local_buf, valid_io_size)) {
+					for(long pos = 0; pos < valid_io_size; pos += edge_unit) {
+						VertexId src = ((Edge*)(edge_local_buf + pos))->src;
+						if(src < last_src) {
+							sorted = false;
+							break;
+						}
+						last_src = src;
+					}
+				}
+			}
+
+			close(fd_edge);
+			return sorted;
+		}
+
+		template<typename EdgeType>
+		void sort_edges(const std::string & edge_file, const std::string & sorted_edge_file) {
+			sorted_stream<EdgeType, src_order<EdgeType>> edges(edge_file, SORT_MEMORY_BUDGET);
+			record_writer<EdgeType> out_edges(sorted_edge_file);
+
+			EdgeType edge;
+			while(edges.next(edge))
+				out_edges.write(edge);
+		}
+
+		std::string get_edge_file(int partition_id) const {
+			return context.filename + "." + std::to_string(partition_id);
+		}
+
 		void join_consumer(Update_Stream out_update_stream, global_buffer<OutUpdateType> ** buffers_for_shuffle) {
 			consumer(out_update_stream, buffers_for_shuffle);
 		}
 
 		// each writer thread generates a join_consumer
 		void consumer(Update_Stream out_update_stream, global_buffer<OutUpdateType> ** buffers_for_shuffle) {
-			int counter = 0;
-
-			while(atomic_num_producers != 0) {
-//				int i = (atomic_partition_id++) % context.num_partitions ;
-				if(counter == context.num_partitions)
-					counter = 0;
-
-				int i = counter++;
-
+			// flush the buffers producers report as full, until all producers are done
+			for(int i = -1; ready_partitions.pop(i); ) {
 				const char * file_name = (context.filename + "." + std::to_string(i) + ".update_stream_" + std::to_string(out_update_stream)).c_str();
 				std::string file_name_str = (context.filename + "." + std::to_string(i) + ".update_stream_" + std::to_string(out_update_stream));
 
@@ -436,88 +654,31 @@ namespace RStream {
 			}
 		}
 
-		void set_difference_producer(Update_Stream update_stream1, Update_Stream update_stream2, global_buffer<OutUpdateType> ** buffers, concurrent_queue<int> * task_queue) {
-//			atomic_num_producers++;
+		void set_difference_worker(Update_Stream update_stream1, Update_Stream update_stream2, Update_Stream out_update_stream, concurrent_queue<int> * task_queue) {
 			int partition_id = -1;
 
 			// pop from queue
 			while(task_queue->test_pop_atomic(partition_id)){
+//				Logger::print_thread_info_locked("as a producer dealing with partition " + std::to_string(partition_id) + "\n");
 
-				int fd_update1 = open((context.filename + "." + std::to_string(partition_id) + ".update_stream_" + std::to_string(update_stream1)).c_str(), O_RDONLY);
-				int fd_update2 = open((context.filename + "." + std::to_string(partition_id) + ".update_stream_" + std::to_string(update_stream2)).c_str(), O_RDONLY);
-				assert(fd_update1 > 0 && fd_update2 > 0 );
-
-				// get file size
-				long update1_file_size = io_manager::get_filesize(fd_update1);
-				long update2_file_size = io_manager::get_filesize(fd_update2);
-
-				// streaming update1
-//				char * update1_buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
-//				int streaming_counter = update1_file_size / IO_SIZE + 1;
-				char * update1_buf = (char *)memalign(PAGE_SIZE, IO_SIZE * sizeof(OutUpdateType));
-				int streaming_counter = update1_file_size / (IO_SIZE * sizeof(OutUpdateType)) + 1;
-
-//				Logger::print_thread_info_locked("as a producer dealing with partition " + std::to_string(partition_id)
-//							+ " of update1 size " + std::to_string(update1_file_size) + ", update2 size " + std::to_string(update2_file_size) + "\n");
-
-				// Assumption: update2 can be fully loaded into memory
-				char * update2_buf = new char[update2_file_size];
-				io_manager::read_from_file(fd_update2, update2_buf, update2_file_size, 0);
+				// the two sorted streams share the budget of the thread
+				sorted_stream<OutUpdateType> updates1(get_update_stream_file(partition_id, update_stream1), SORT_MEMORY_BUDGET / 2);
+				sorted_stream<OutUpdateType> updates2(get_update_stream_file(partition_id, update_stream2), SORT_MEMORY_BUDGET / 2);
+				record_writer<OutUpdateType> out_updates(get_update_stream_file(partition_id, out_update_stream));
 
-				std::unordered_set<OutUpdateType> set_of_updates2;
-				build_update_hashset(update2_buf, set_of_updates2, update2_file_size);
-
-				long valid_io_size = 0;
-				long offset = 0;
-
-				// for all streaming updates
-				for(int counter = 0; counter < streaming_counter; counter++) {
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-//						valid_io_size = update1_file_size - IO_SIZE * (streaming_counter - 1);
-						valid_io_size = update1_file_size - IO_SIZE * sizeof(OutUpdateType) * (streaming_counter - 1);
-					else
-//						valid_io_size = IO_SIZE;
-						valid_io_size = IO_SIZE * sizeof(OutUpdateType);
-
-					assert(valid_io_size % sizeof(OutUpdateType) == 0);
-//					Logger::print_thread_info_locked(std::to_string(counter) + "th streaming, start set diff of size "
-//								+ std::to_string(valid_io_size) + " with partition " + std::to_string(partition_id) + "\n");
-
-					io_manager::read_from_file(fd_update1, update1_buf, valid_io_size, offset);
-					offset += valid_io_size;
+				OutUpdateType one_update1, one_update2;
+				bool has_update2 = updates2.next(one_update2);
+				while(updates1.next(one_update1)) {
+					// skip the updates2 smaller than one_update1, they are in no update1
+					while(has_update2 && record_less(one_update2, one_update1))
+						has_update2 = updates2.next(one_update2);
 
-					// streaming update1 in, do set difference
-					for(long pos = 0; pos < valid_io_size; pos += sizeof(OutUpdateType)) {
-						// get an update1
-						OutUpdateType * one_update1 = (OutUpdateType*)(update1_buf + pos);
-						auto existed = set_of_updates2.find(*one_update1);
+					if(has_update2 && record_equal(one_update1, one_update2))
+						continue;
 
-						if(existed != set_of_updates2.end())
-							continue;
-
-						int index = partition_id;
-						global_buffer<OutUpdateType>* global_buf = buffer_manager<OutUpdateType>::get_global_buffer(buffers, context.num_partitions, index);
-						global_buf->insert(one_update1, index);
-					}
-
-//					Logger::print_thread_info_locked(std::to_string(counter) + "th streaming, finish set diff of size "
-//								+ std::to_string(valid_io_size) + " with partition " + std::to_string(partition_id) + "\n");
+					out_updates.write(one_update1);
 				}
-
-				free(update1_buf);
-				delete[] update2_buf;
-
-				close(fd_update1);
-				close(fd_update2);
 			}
-
-			atomic_num_producers--;
-		}
-
-		void set_difference_consumer(Update_Stream out_update_stream, global_buffer<OutUpdateType> ** buffers) {
-			consumer(out_update_stream, buffers);
 		}
 
 		void union_relation_worker(Update_Stream update_stream1, Update_Stream update_stream2, concurrent_queue<int> * task_queue) {
@@ -552,64 +713,27 @@ namespace RStream {
 			int partition_id = -1;
 
 			while(task_queue->test_pop_atomic(partition_id)) {
-				int fd_update = open((context.filename + "." + std::to_string(partition_id) + ".update_stream_" + std::to_string(in_update_stream)).c_str(), O_RDONLY);
-				assert(fd_update > 0);
-
-				// get file size
-				long update_file_size = io_manager::get_filesize(fd_update);
-				char * update_buf = (char *)memalign(PAGE_SIZE, IO_SIZE * sizeof(OutUpdateType));
-				int streaming_counter = update_file_size / (IO_SIZE * sizeof(OutUpdateType)) + 1;
+//				Logger::print_thread_info_locked("as a producer, remove dup with partition " + std::to_string(partition_id) + "\n");
 
-//				Logger::print_thread_info_locked("as a producer, remove dup with partition " + std::to_string(partition_id)
-//							+ " of update1 size " + std::to_string(update_file_size) + "\n");
+				sorted_stream<OutUpdateType> updates(get_update_stream_file(partition_id, in_update_stream), SORT_MEMORY_BUDGET);
+				record_writer<OutUpdateType> out_updates(get_update_stream_file(partition_id, out_update_stream));
 
-				std::unordered_set<OutUpdateType> set_of_updates;
+				// duplicates are adjacent once sorted
+				OutUpdateType one_update, last_update;
+				bool has_last = false;
+				while(updates.next(one_update)) {
+					if(has_last && record_equal(one_update, last_update))
+						continue;
 
-				long valid_io_size = 0;
-				long offset = 0;
-				// for all streaming updates
-				for(int counter = 0; counter < streaming_counter; counter++) {
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-						valid_io_size = update_file_size - IO_SIZE * sizeof(OutUpdateType) * (streaming_counter - 1);
-					else
-						valid_io_size = IO_SIZE * sizeof(OutUpdateType);
-
-					assert(valid_io_size % sizeof(OutUpdateType) == 0);
-					io_manager::read_from_file(fd_update, update_buf, valid_io_size, offset);
-					offset += valid_io_size;
-
-					build_update_hashset(update_buf, set_of_updates, valid_io_size);
+					out_updates.write(one_update);
+					last_update = one_update;
+					has_last = true;
 				}
-
-				std::vector<OutUpdateType> out_updates;
-				std::copy(set_of_updates.begin(), set_of_updates.end(), std::back_inserter(out_updates));
-//				const char * file_name = (context.filename + "." + std::to_string(partition_id) + ".update_stream_" + std::to_string(out_update_stream)).c_str();
-
-				std::string file_name_str = (context.filename + "." + std::to_string(partition_id) + ".update_stream_" + std::to_string(out_update_stream));
-				char* buf = reinterpret_cast<char*>(out_updates.data());
-				write_updates_to_file(buf, file_name_str, out_updates.size() * sizeof(OutUpdateType));
-
-//				Logger::print_thread_info_locked("as a producer finish remove dup with partition " + std::to_string(partition_id)
-//								+ " of update1 size " + std::to_string(update_file_size) + "\n");
-
-				free(update_buf);
-				close(fd_update);
 			}
 		}
 
-		void write_updates_to_file(char * buf, std::string file, size_t length) {
-			const char * file_name = file.c_str();
-			int perms = O_WRONLY | O_APPEND;
-			int fd = open(file_name, perms, S_IRWXU);
-			if(fd < 0){
-				fd = creat(file_name, S_IRWXU);
-			}
-
-			// flush buffer to update out stream
-			io_manager::write_to_file(fd, buf, length);
-			close(fd);
+		std::string get_update_stream_file(int partition_id, Update_Stream update_stream) {
+			return context.filename + "." + std::to_string(partition_id) + ".update_stream_" + std::to_string(update_stream);
 		}
 
 		void build_edge_hashmap(char * edge_buf, std::vector<std::vector<VertexId>> & edge_hashmap, size_t edge_file_size, int start_vertex) {
@@ -625,15 +749,6 @@ namespace RStream {
 			}
 		}
 
-		void build_update_hashset(char * update_buf, std::unordered_set<OutUpdateType> & set_of_updates, size_t update_file_size) {
-			// for each update
-			for(size_t pos = 0;  pos < update_file_size; pos += sizeof(OutUpdateType)) {
-				// get an update
-				OutUpdateType  one_update = *(OutUpdateType*)(update_buf + pos);
-				set_of_updates.insert(one_update);
-
-			}
-		}
 //
 //		int get_global_buffer_index(OutUpdateType* new_update) {
 ////			return new_update->target / context.num_vertices_per_part;
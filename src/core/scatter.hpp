@@ -31,8 +31,10 @@ namespace RStream {
 		Scatter(Engine & e): context(e) {}
 		virtual ~Scatter() {}
 
-		/* scatter with vertex data (for graph computation use)*/
-		Update_Stream scatter_with_vertex(std::function<UpdateType*(Edge*, VertexDataType*)> generate_one_update) {
+		/* scatter with vertex data (for graph computation use)
+		 * @param emit_one_update -fills in the update for an edge and its src vertex, in place
+		 * */
+		Update_Stream scatter_with_vertex(std::function<void(Edge*, VertexDataType*, UpdateType&)> emit_one_update) {
 			atomic_init();
 
 //			Logger::print_thread_info_locked("--------------------Start Scatter Phase--------------------\n\n");
@@ -80,12 +82,12 @@ namespace RStream {
 			}
 
 			// allocate global buffers for shuffling
-			global_buffer<UpdateType> ** buffers_for_shuffle = buffer_manager<UpdateType>::get_global_buffers(context.num_partitions);
+			global_buffer<UpdateType> ** buffers_for_shuffle = buffer_manager<UpdateType>::get_global_buffers(context.num_partitions, &ready_partitions);
 
 			// exec threads will produce updates and push into shuffle buffers
 			std::vector<std::thread> exec_threads;
 			for(int i = 0; i < context.num_exec_threads; i++)
-				exec_threads.push_back( std::thread([=] { this->scatter_producer_with_vertex(generate_one_update, buffers_for_shuffle, task_queue); } ));
+				exec_threads.push_back( std::thread([=] { this->scatter_producer_with_vertex(emit_one_update, buffers_for_shuffle, task_queue); } ));
 
 			// write threads will flush shuffle buffer to update out stream file as long as it's full
 			std::vector<std::thread> write_threads;
@@ -96,6 +98,9 @@ namespace RStream {
 			for(auto & t : exec_threads)
 				t.join();
 
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
 			for(auto &t : write_threads)
 				t.join();
 
@@ -107,8 +112,10 @@ namespace RStream {
 			return update_c;
 		}
 
-		/* scatter without vertex data (for relational algebra use)*/
-		Update_Stream scatter_no_vertex(std::function<UpdateType*(Edge*)> generate_one_update) {
+		/* scatter without vertex data (for relational algebra use)
+		 * @param emit_one_update -fills in the update for an edge, in place
+		 * */
+		Update_Stream scatter_no_vertex(std::function<void(Edge*, UpdateType&)> emit_one_update) {
 			atomic_init();
 
 //			Logger::print_thread_info_locked("--------------------Start Scatter Phase--------------------\n\n");
@@ -118,7 +125,7 @@ namespace RStream {
 			concurrent_queue<int> * task_queue = new concurrent_queue<int>(context.num_partitions);
 
 			// allocate global buffers for shuffling
-			global_buffer<UpdateType> ** buffers_for_shuffle = buffer_manager<UpdateType>::get_global_buffers(context.num_partitions);
+			global_buffer<UpdateType> ** buffers_for_shuffle = buffer_manager<UpdateType>::get_global_buffers(context.num_partitions, &ready_partitions);
 
 			// push task into concurrent queue
 			for(int partition_id = 0; partition_id < context.num_partitions; partition_id++) {
@@ -133,7 +140,7 @@ namespace RStream {
 			// exec threads will produce updates and push into shuffle buffers
 			std::vector<std::thread> exec_threads;
 			for(int i = 0; i < context.num_exec_threads; i++)
-				exec_threads.push_back(std::thread([=] { this->scatter_producer_no_vertex(generate_one_update, buffers_for_shuffle, task_queue); }));
+				exec_threads.push_back(std::thread([=] { this->scatter_producer_no_vertex(emit_one_update, buffers_for_shuffle, task_queue); }));
 
 			// write threads will flush shuffle buffer to update out stream file as long as it's full
 			std::vector<std::thread> write_threads;
@@ -144,6 +151,9 @@ namespace RStream {
 			for(auto & t : exec_threads)
 				t.join();
 
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
 			for(auto &t : write_threads)
 				t.join();
 
@@ -159,20 +169,19 @@ namespace RStream {
 		void atomic_init() {
 			atomic_num_producers = context.num_exec_threads;
 			atomic_partition_number = context.num_partitions;
-		}
-
-		void load_vertices_hashMap(char* vertex_local_buf, const int vertex_file_size, std::unordered_map<VertexId, VertexDataType*> & vertex_map) {
-			for(size_t off = 0; off < vertex_file_size; off += context.vertex_unit){
-				VertexDataType* v = reinterpret_cast<VertexDataType*>(vertex_local_buf + off);
-				vertex_map[v->id] = v;
-			}
+			ready_partitions.reset();
 		}
 
 //		void scatter_producer_with_vertex(std::function<UpdateType*(Edge*, VertexDataType*)> generate_one_update,
 //						global_buffer<UpdateType> ** buffers_for_shuffle, concurrent_queue<int> * task_queue) {
 
-		void scatter_producer_with_vertex(std::function<UpdateType*(Edge*, VertexDataType*)> generate_one_update,
+		void scatter_producer_with_vertex(std::function<void(Edge*, VertexDataType*, UpdateType&)> emit_one_update,
 								global_buffer<UpdateType> ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long>> * task_queue) {
+			// stage updates per partition locally, publish them to the shared buffers in batches
+			local_buffer<UpdateType> ** local_buffers = buffer_manager<UpdateType>::get_local_buffers(buffers_for_shuffle, context.num_partitions);
+			// slot the user callback writes each update into, reused for every edge
+			UpdateType update_info;
+
 
 //			int partition_id = -1;
 			VertexId vertex_start = -1;
@@ -207,42 +216,22 @@ namespace RStream {
 				// vertex data fully loaded into memory
 				char * vertex_local_buf = new char[vertex_file_size];
 				io_manager::read_from_file(fd_vertex, vertex_local_buf, vertex_file_size, 0);
-				std::unordered_map<VertexId, VertexDataType*> vertex_map;
-				load_vertices_hashMap(vertex_local_buf, vertex_file_size, vertex_map);
+				vertex_view<VertexDataType> vertices(vertex_local_buf, vertex_file_size, vertex_start);
 
 				// streaming edges
-				char * edge_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE * sizeof(Edge));
-//				int streaming_counter = edge_file_size / (IO_SIZE * sizeof(Edge)) + 1;
-				int streaming_counter = chunk_size / (IO_SIZE * sizeof(Edge)) + 1;
 				assert((chunk_size % sizeof(Edge)) == 0);
+				stream_reader edge_reader(fd_edge, chunk_offset, chunk_size, IO_SIZE * sizeof(Edge));
+				char * edge_local_buf = nullptr;
 
 				long valid_io_size = 0;
-				long offset = 0;
 				int edge_unit = context.edge_unit;
 
 				assert(edge_unit == sizeof(Edge));
 
 				// for all streaming
-				for(int counter = 0; counter < streaming_counter; counter++) {
-
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-	//						valid_io_size = edge_file_size - IO_SIZE * (streaming_counter - 1);
-//						valid_io_size = edge_file_size - IO_SIZE * sizeof(Edge) * (streaming_counter - 1);
-						valid_io_size = chunk_size - IO_SIZE * sizeof(Edge) * (streaming_counter - 1);
-					else
-	//						valid_io_size = IO_SIZE;
-						valid_io_size = IO_SIZE * sizeof(Edge);
-
+				while(edge_reader.next(edge_local_buf, valid_io_size)) {
 					assert(valid_io_size % edge_unit == 0);
 
-	//					io_manager::read_from_file(fd_edge, edge_local_buf, valid_io_size);
-//					io_manager::read_from_file(fd_edge, edge_local_buf, valid_io_size, offset);
-					io_manager::read_from_file(fd_edge, edge_local_buf, valid_io_size, chunk_offset + offset);
-
-					offset += valid_io_size;
-
 					// for each streaming
 					for(long pos = 0; pos < valid_io_size; pos += edge_unit) {
 						// get an edge
@@ -250,24 +239,20 @@ namespace RStream {
 	//					std::cout << e << std::endl;
 
 						// get src vertex in vertex buf
-						size_t offset = (e->src - vertex_start) * sizeof(VertexDataType);
-						VertexDataType* src_vertex = reinterpret_cast<VertexDataType*>(vertex_local_buf + offset);
+						VertexDataType* src_vertex = vertices.get(e->src);
 
-						UpdateType * update_info = generate_one_update(e, src_vertex);
-	//					std::cout << update_info->target << std::endl;
+						emit_one_update(e, src_vertex, update_info);
+	//					std::cout << update_info.target << std::endl;
 
 						// insert into shuffle buffer accordingly
-						int index = meta_info::get_index(update_info->target, context);
-						global_buffer<UpdateType>* global_buf = buffer_manager<UpdateType>::get_global_buffer(buffers_for_shuffle, context.num_partitions, index);
-						global_buf->insert(update_info, index);
-
-						delete update_info;
+						int index = meta_info::get_index(update_info.target, context);
+						local_buffer<UpdateType>* local_buf = buffer_manager<UpdateType>::get_local_buffer(local_buffers, context.num_partitions, index);
+						local_buf->insert(&update_info);
 					}
 				}
 
 				// delete
 				delete[] vertex_local_buf;
-				free(edge_local_buf);
 
 	//				//clear vertex_map
 	//				for(auto it = vertex_map.cbegin(); it != vertex_map.cend(); ++it){
@@ -278,11 +263,17 @@ namespace RStream {
 				close(fd_edge);
 
 			}
+			buffer_manager<UpdateType>::release_local_buffers(local_buffers, context.num_partitions);
 			atomic_num_producers--;
 		}
 
-		void scatter_producer_no_vertex(std::function<UpdateType*(Edge*)> generate_one_update,
+		void scatter_producer_no_vertex(std::function<void(Edge*, UpdateType&)> emit_one_update,
 						global_buffer<UpdateType> ** buffers_for_shuffle, concurrent_queue<int> * task_queue) {
+			// stage updates per partition locally, publish them to the shared buffers in batches
+			local_buffer<UpdateType> ** local_buffers = buffer_manager<UpdateType>::get_local_buffers(buffers_for_shuffle, context.num_partitions);
+			// slot the user callback writes each update into, reused for every edge
+			UpdateType update_info;
+
 			int partition_id = -1;
 
 			for(unsigned int i = 0; i < context.num_partitions; i++) {
@@ -299,32 +290,17 @@ namespace RStream {
 //				Logger::print_thread_info_locked("as a producer dealing with partition " + std::to_string(partition_id) + " of size " + std::to_string(file_size) + "\n");
 
 				// streaming edges
-				char * local_buf = (char*)memalign(PAGE_SIZE, IO_SIZE * sizeof(Edge));
-				int streaming_counter = file_size / (IO_SIZE * sizeof(Edge)) + 1;
-
 				assert((file_size % sizeof(Edge)) == 0);
+				stream_reader edge_reader(fd, 0, file_size, IO_SIZE * sizeof(Edge));
+				char * local_buf = nullptr;
 
 				long valid_io_size = 0;
-				long offset = 0;
 				int edge_unit = context.edge_unit;
 
 				// for all streaming
-				for(int counter = 0; counter < streaming_counter; counter++) {
-
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-	//						valid_io_size = file_size - IO_SIZE * (streaming_counter - 1);
-						valid_io_size = file_size - IO_SIZE * sizeof(Edge) * (streaming_counter - 1);
-					else
-	//						valid_io_size = IO_SIZE;
-						valid_io_size = IO_SIZE * sizeof(Edge);
-
+				while(edge_reader.next(local_buf, valid_io_size)) {
 					assert(valid_io_size % edge_unit == 0);
 
-					io_manager::read_from_file(fd, local_buf, valid_io_size, offset);
-					offset += valid_io_size;
-
 					// for each streaming
 					for(long pos = 0; pos < valid_io_size; pos += edge_unit) {
 						// get an edge
@@ -332,35 +308,27 @@ namespace RStream {
 	//					std::cout << e << std::endl;
 
 						// gen one update
-						UpdateType * update_info = generate_one_update(e);
-	//					std::cout << update_info->target << std::endl;
+						emit_one_update(e, update_info);
+	//					std::cout << update_info.target << std::endl;
 
-						int index = meta_info::get_index(update_info->target, context);
+						int index = meta_info::get_index(update_info.target, context);
 						assert(index >= 0);
 
-						global_buffer<UpdateType>* global_buf = buffer_manager<UpdateType>::get_global_buffer(buffers_for_shuffle, context.num_partitions, index);
-						global_buf->insert(update_info, index);
-
-						delete update_info;
+						local_buffer<UpdateType>* local_buf = buffer_manager<UpdateType>::get_local_buffer(local_buffers, context.num_partitions, index);
+						local_buf->insert(&update_info);
 					}
 				}
 
-				free(local_buf);
 				close(fd);
 
 			}
+			buffer_manager<UpdateType>::release_local_buffers(local_buffers, context.num_partitions);
 			atomic_num_producers--;
 		}
 
 		void scatter_consumer(global_buffer<UpdateType> ** buffers_for_shuffle, Update_Stream update_count) {
-			int counter = 0;
-
-			while(atomic_num_producers != 0) {
-				if(counter == context.num_partitions)
-					counter = 0;
-
-				int i = counter++;
-
+			// flush the buffers producers report as full, until all producers are done
+			for(int i = -1; ready_partitions.pop(i); ) {
 //				const char * file_name = (context.filename + "." + std::to_string(i) + ".update_stream_" + std::to_string(update_count)).c_str();
 				std::string file_name_str = (context.filename + "." + std::to_string(i) + ".update_stream_" + std::to_string(update_count));
 
@@ -606,32 +574,19 @@ public:
 				int target_partition = 0;
 
 				// streaming edges
-				char * edge_local_buf = (char *)memalign(PAGE_SIZE, IO_SIZE * sizeof(Edge));
-				int streaming_counter = chunk_size / (IO_SIZE * sizeof(Edge)) + 1;
 				assert((chunk_size % sizeof(Edge)) == 0);
+				stream_reader edge_reader(fd_edge, chunk_offset, chunk_size, IO_SIZE * sizeof(Edge));
+				char * edge_local_buf = nullptr;
 
 				long valid_io_size = 0;
-				long offset = 0;
 				int edge_unit = context.edge_unit;
 
 				assert(edge_unit == sizeof(Edge));
 
 				// for all streaming
-				for(int counter = 0; counter < streaming_counter; counter++) {
-
-					// last streaming
-					if(counter == streaming_counter - 1)
-						// TODO: potential overflow?
-						valid_io_size = chunk_size - IO_SIZE * sizeof(Edge) * (streaming_counter - 1);
-					else
-						valid_io_size = IO_SIZE * sizeof(Edge);
-
+				while(edge_reader.next(edge_local_buf, valid_io_size)) {
 					assert(valid_io_size % edge_unit == 0);
 
-					io_manager::read_from_file(fd_edge, edge_local_buf, valid_io_size, chunk_offset + offset);
-
-					offset += valid_io_size;
-
 					// for each streaming
 					for(long pos = 0; pos < valid_io_size; pos += edge_unit) {
 						// get an edge
@@ -644,8 +599,6 @@ public:
 					}
 				}
 
-				// delete
-				free(edge_local_buf);
 				close(fd_edge);
 
 			}
@@ -706,6 +659,8 @@ public:
 		const Engine& context;
 		std::atomic<int> atomic_num_producers;
 		std::atomic<int> atomic_partition_number;
+		// ids of shuffle buffers ready to be flushed, consumed by the writer threads
+		blocking_queue<int> ready_partitions;
 
 
 	};
@@ -23,6 +23,8 @@ namespace RStream {
 		std::atomic<int> atomic_num_producers;
 		std::atomic<int> atomic_partition_id;
 		std::atomic<int> atomic_partition_number;
+		// ids of shuffle buffers ready to be flushed, consumed by the writer threads
+		blocking_queue<int> ready_partitions;
 
 	public:
 
@@ -31,12 +33,14 @@ namespace RStream {
 		void atomic_init() {
 			atomic_num_producers = context.num_exec_threads;
 			atomic_partition_number = context.num_partitions;
+			ready_partitions.reset();
 		}
 
 		/*
 		 * given an in_update, generate an out_update and scatter
+		 * @param emit_one_update -fills in the out_update for an in_update, in place
 		 * */
-		Update_Stream scatter_updates(Update_Stream in_update_stream, std::function<OutUpdateType*(InUpdateType*)> generate_one_update) {
+		Update_Stream scatter_updates(Update_Stream in_update_stream, std::function<void(InUpdateType*, OutUpdateType&)> emit_one_update) {
 			atomic_init();
 
 			Update_Stream update_c = Engine::update_count++;
@@ -44,7 +48,7 @@ namespace RStream {
 			concurrent_queue<int> * task_queue = new concurrent_queue<int>(context.num_partitions);
 
 			// allocate global buffers for shuffling
-			global_buffer<OutUpdateType> ** buffers_for_shuffle = buffer_manager<OutUpdateType>::get_global_buffers(context.num_partitions);
+			global_buffer<OutUpdateType> ** buffers_for_shuffle = buffer_manager<OutUpdateType>::get_global_buffers(context.num_partitions, &ready_partitions);
 
 			// push task into concurrent queue
 			for(int partition_id = 0; partition_id < context.num_partitions; partition_id++) {
@@ -54,7 +58,7 @@ namespace RStream {
 			// exec threads will produce updates and push into shuffle buffers
 			std::vector<std::thread> exec_threads;
 			for(int i = 0; i < context.num_exec_threads; i++)
-				exec_threads.push_back(std::thread([=] { this->scatter_updates_producer(in_update_stream, generate_one_update, buffers_for_shuffle, task_queue); }));
+				exec_threads.push_back(std::thread([=] { this->scatter_updates_producer(in_update_stream, emit_one_update, buffers_for_shuffle, task_queue); }));
 
 			// write threads will flush shuffle buffer to update out stream file as long as it's full
 			std::vector<std::thread> write_threads;
@@ -65,6 +69,9 @@ namespace RStream {
 			for(auto & t : exec_threads)
 				t.join();
 
+			// no more full buffers will be reported, let the writers finish up
+			ready_partitions.close();
+
 			for(auto &t : write_threads)
 				t.join();
 
@@ -75,8 +82,13 @@ namespace RStream {
 		}
 
 	private:
-		void scatter_updates_producer(Update_Stream in_update_stream, std::function<OutUpdateType*(InUpdateType*)> generate_one_update,
+		void scatter_updates_producer(Update_Stream in_update_stream, std::function<void(InUpdateType*, OutUpdateType&)> emit_one_update,
 						global_buffer<OutUpdateType> ** buffers_for_shuffle, concurrent_queue<int> * task_queue) {
+			// stage updates per partition locally, publish them to the shared buffers in batches
+			local_buffer<OutUpdateType> ** local_buffers = buffer_manager<OutUpdateType>::get_local_buffers(buffers_for_shuffle, context.num_partitions);
+			// slot the user callback writes each out_update into, reused for every in_update
+			OutUpdateType out_update;
+
 
 //			atomic_num_producers++;
 			int partition_id = -1;
@@ -120,12 +132,12 @@ namespace RStream {
 						InUpdateType * in_update = (InUpdateType*)(update_local_buf + pos);
 
 						// gen an out_update
-						OutUpdateType * out_update = generate_one_update(in_update);
+						emit_one_update(in_update, out_update);
 
 						// insert into shuffle buffer accordingly
-						int index = get_global_buffer_index(out_update);
-						global_buffer<OutUpdateType>* global_buf = buffer_manager<OutUpdateType>::get_global_buffer(buffers_for_shuffle, context.num_partitions, index);
-						global_buf->insert(out_update, index);
+						int index = get_global_buffer_index(&out_update);
+						local_buffer<OutUpdateType>* local_buf = buffer_manager<OutUpdateType>::get_local_buffer(local_buffers, context.num_partitions, index);
+						local_buf->insert(&out_update);
 
 					}
 				}
@@ -134,18 +146,14 @@ namespace RStream {
 				close(fd_update);
 			}
 
+			buffer_manager<OutUpdateType>::release_local_buffers(local_buffers, context.num_partitions);
 			atomic_num_producers--;
 		}
 
 		// each writer thread generates a scatter_consumer
 		void scatter_updates_consumer(global_buffer<OutUpdateType> ** buffers_for_shuffle, Update_Stream update_count) {
-			unsigned int counter = 0;
-			while(atomic_num_producers != 0) {
-//				int i = (atomic_partition_id++) % context.num_partitions ;
-				if(counter == context.num_partitions)
-					counter = 0;
-				unsigned int i = counter++;
-
+			// flush the buffers producers report as full, until all producers are done
+			for(int i = -1; ready_partitions.pop(i); ) {
 				const char * file_name = (context.filename + "." + std::to_string(i) + ".update_stream_" + std::to_string(update_count)).c_str();
 				global_buffer<OutUpdateType>* g_buf = buffer_manager<OutUpdateType>::get_global_buffer(buffers_for_shuffle, context.num_partitions, i);
 				g_buf->flush(file_name, i);
@@ -173,8 +181,7 @@ namespace RStream {
 		int get_global_buffer_index(OutUpdateType* out_update) {
 		//			return update_info->target / context.num_vertices_per_part;
 
-			int partition_id = out_update->target / context.num_vertices_per_part;
-			return partition_id < (context.num_partitions - 1) ? partition_id : (context.num_partitions - 1);
+			return context.router.get_index(out_update->target);
 		}
 
 	};
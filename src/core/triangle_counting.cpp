@@ -0,0 +1,348 @@
+/*
+ * triangle_counting.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ */
+
+#include "triangle_counting.hpp"
+
+namespace RStream {
+
+		triangle_counting::triangle_counting(Engine & e, long _memory_budget) : context(e), memory_budget(_memory_budget), oriented(false) {
+
+		}
+
+		triangle_counting::~triangle_counting() {
+			if(!oriented)
+				return;
+
+			for(int partition_id = 0; partition_id < context.num_partitions; partition_id++)
+				FileUtil::delete_file(get_partition_file(partition_id));
+		}
+
+		long triangle_counting::count() {
+			return run(false, 0);
+		}
+
+		Update_Stream triangle_counting::list() {
+			Update_Stream update_c = Engine::update_count++;
+
+			// every partition gets a stream file, even if none of its vertices closes a triangle
+			for(int partition_id = 0; partition_id < context.num_partitions; partition_id++) {
+				int fd = open((context.filename + "." + std::to_string(partition_id) + ".update_stream_" + std::to_string(update_c)).c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
+				assert(fd > 0);
+				close(fd);
+			}
+
+			run(true, update_c);
+			return update_c;
+		}
+
+		// three passes over the partitions: undirected degrees, then every edge oriented and routed to the partition
+		// of its new source, then one sorted, deduplicated csr per partition
+		void triangle_counting::orient() {
+			if(oriented)
+				return;
+
+			const int num_partitions = context.num_partitions;
+			const int edge_unit = context.edge_unit;
+			const long num_vertices = context.vertex_intervals.back().second + 1;
+			// Edge, WeightedEdge and LabeledEdge all start with src and target
+			assert(edge_unit >= (int)sizeof(Edge));
+			const long io_size = IO_SIZE / edge_unit * edge_unit;
+
+			// both directions count, so inputs listing each edge once or twice orient the same way
+			std::vector<std::atomic<unsigned int>> degrees(num_vertices);
+			run_per_partition([&](int partition_id) {
+				int fd_edge = open((context.filename + "." + std::to_string(partition_id)).c_str(), O_RDONLY);
+				assert(fd_edge > 0);
+
+				stream_reader edge_reader(fd_edge, 0, io_manager::get_filesize(fd_edge), io_size);
+				char * edge_local_buf = nullptr;
+				long valid_io_size = 0;
+				while(edge_reader.next(edge_local_buf, valid_io_size)) {
+					assert(valid_io_size % edge_unit == 0);
+					for(long pos = 0; pos < valid_io_size; pos += edge_unit) {
+						Edge * e = (Edge*)(edge_local_buf + pos);
+						degrees[e->src].fetch_add(1, std::memory_order_relaxed);
+						degrees[e->target].fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+
+				close(fd_edge);
+			});
+
+			std::vector<int> fds(num_partitions);
+			std::vector<std::mutex> locks(num_partitions);
+			for(int partition_id = 0; partition_id < num_partitions; partition_id++) {
+				fds[partition_id] = open(get_oriented_edges_file(partition_id).c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
+				assert(fds[partition_id] > 0);
+			}
+
+			run_per_partition([&](int partition_id) {
+				int fd_edge = open((context.filename + "." + std::to_string(partition_id)).c_str(), O_RDONLY);
+				assert(fd_edge > 0);
+
+				// oriented edges staged per target partition, appended in blocks
+				const size_t block_size = LOCAL_BUFFER_SIZE / sizeof(Edge);
+				std::vector<std::vector<Edge>> local_edges(num_partitions);
+				auto flush = [&](int target_partition) {
+					std::unique_lock<std::mutex> lock(locks[target_partition]);
+					io_manager::append_to_file(fds[target_partition], (char*)local_edges[target_partition].data(), local_edges[target_partition].size() * sizeof(Edge));
+					local_edges[target_partition].clear();
+				};
+
+				stream_reader edge_reader(fd_edge, 0, io_manager::get_filesize(fd_edge), io_size);
+				char * edge_local_buf = nullptr;
+				long valid_io_size = 0;
+				while(edge_reader.next(edge_local_buf, valid_io_size)) {
+					for(long pos = 0; pos < valid_io_size; pos += edge_unit) {
+						Edge e = *(Edge*)(edge_local_buf + pos);
+						if(e.src == e.target)
+							continue;
+
+						unsigned int degree_src = degrees[e.src].load(std::memory_order_relaxed);
+						unsigned int degree_target = degrees[e.target].load(std::memory_order_relaxed);
+						if(degree_target < degree_src || (degree_target == degree_src && e.target < e.src))
+							std::swap(e.src, e.target);
+
+						int target_partition = meta_info::get_index(e.src, context);
+						local_edges[target_partition].push_back(e);
+						if(local_edges[target_partition].size() >= block_size)
+							flush(target_partition);
+					}
+				}
+
+				for(int target_partition = 0; target_partition < num_partitions; target_partition++) {
+					if(!local_edges[target_partition].empty())
+						flush(target_partition);
+				}
+
+				close(fd_edge);
+			});
+
+			for(int partition_id = 0; partition_id < num_partitions; partition_id++)
+				close(fds[partition_id]);
+
+			partition_bytes.assign(num_partitions, 0);
+			partition_targets.assign(num_partitions, std::vector<bool>(num_partitions, false));
+			run_per_partition([&](int partition_id) { build_partition(partition_id); });
+
+			oriented = true;
+		}
+
+		void triangle_counting::build_partition(int partition_id) {
+			const VertexId first = context.vertex_intervals[partition_id].first, last = context.vertex_intervals[partition_id].second;
+			const std::string oriented_edges_file = get_oriented_edges_file(partition_id);
+
+			int fd = open(oriented_edges_file.c_str(), O_RDONLY);
+			assert(fd > 0);
+			long file_size = io_manager::get_filesize(fd);
+			assert(file_size % sizeof(Edge) == 0);
+			std::vector<Edge> edges(file_size / sizeof(Edge));
+			io_manager::read_from_file(fd, (char*)edges.data(), file_size, 0);
+			close(fd);
+			FileUtil::delete_file(oriented_edges_file);
+
+			// counting sort on the source
+			oriented_partition p;
+			p.first = first;
+			p.last = last;
+			p.offsets.assign(last - first + 2, 0);
+			for(auto & e : edges) {
+				assert(e.src >= first && e.src <= last);
+				p.offsets[e.src - first + 1]++;
+			}
+			for(long i = 0; i < last - first + 1; i++)
+				p.offsets[i + 1] += p.offsets[i];
+
+			std::vector<long> cursors(p.offsets.begin(), p.offsets.end() - 1);
+			p.neighbors.resize(edges.size());
+			for(auto & e : edges)
+				p.neighbors[cursors[e.src - first]++] = e.target;
+			std::vector<Edge>().swap(edges);
+
+			// sort every range and drop the edges listed twice, compacting in place
+			long num_edges = 0;
+			for(long i = 0; i < last - first + 1; i++) {
+				VertexId * range_begin = p.neighbors.data() + p.offsets[i];
+				VertexId * range_end = p.neighbors.data() + p.offsets[i + 1];
+				std::sort(range_begin, range_end);
+				VertexId * unique_end = std::unique(range_begin, range_end);
+
+				p.offsets[i] = num_edges;
+				for(VertexId * it = range_begin; it != unique_end; ++it) {
+					p.neighbors[num_edges++] = *it;
+					partition_targets[partition_id][meta_info::get_index(*it, context)] = true;
+				}
+			}
+			p.offsets[last - first + 1] = num_edges;
+			p.neighbors.resize(num_edges);
+
+			// header: first and last vertex, number of edges
+			long header[3] = {first, last, num_edges};
+			fd = open(get_partition_file(partition_id).c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
+			assert(fd > 0);
+			io_manager::write_to_file(fd, (char*)header, sizeof(header));
+			io_manager::append_to_file(fd, (char*)p.offsets.data(), p.offsets.size() * sizeof(long));
+			io_manager::append_to_file(fd, (char*)p.neighbors.data(), num_edges * sizeof(VertexId));
+			close(fd);
+
+			partition_bytes[partition_id] = p.offsets.size() * sizeof(long) + num_edges * sizeof(VertexId);
+		}
+
+		std::shared_ptr<oriented_partition> triangle_counting::load_partition(int partition_id) {
+			int fd = open(get_partition_file(partition_id).c_str(), O_RDONLY);
+			assert(fd > 0);
+
+			long header[3];
+			io_manager::read_from_file(fd, (char*)header, sizeof(header), 0);
+
+			std::shared_ptr<oriented_partition> p(new oriented_partition());
+			p->first = header[0];
+			p->last = header[1];
+			p->offsets.resize(p->last - p->first + 2);
+			p->neighbors.resize(header[2]);
+
+			size_t offset = sizeof(header);
+			io_manager::read_from_file(fd, (char*)p->offsets.data(), p->offsets.size() * sizeof(long), offset);
+			offset += p->offsets.size() * sizeof(long);
+			io_manager::read_from_file(fd, (char*)p->neighbors.data(), p->neighbors.size() * sizeof(VertexId), offset);
+
+			close(fd);
+			return p;
+		}
+
+		long triangle_counting::run(bool list, Update_Stream out_stream) {
+			orient();
+
+			const int num_partitions = context.num_partitions;
+			long total_bytes = 0;
+			for(int partition_id = 0; partition_id < num_partitions; partition_id++)
+				total_bytes += partition_bytes[partition_id];
+			const bool in_memory = total_bytes <= memory_budget;
+
+			std::vector<std::shared_ptr<oriented_partition>> partitions(num_partitions);
+			long num_triangles = 0;
+			for(int p = 0; p < num_partitions; p++) {
+				if(!partitions[p])
+					partitions[p] = load_partition(p);
+
+				// triangles are listed to the stream of the partition of their first vertex
+				int fd_out = -1;
+				if(list) {
+					fd_out = open((context.filename + "." + std::to_string(p) + ".update_stream_" + std::to_string(out_stream)).c_str(), O_WRONLY);
+					assert(fd_out > 0);
+				}
+
+				for(int q = 0; q < num_partitions; q++) {
+					// no vertex of p points into q, so no triangle has its first two vertices in p and q
+					if(!partition_targets[p][q])
+						continue;
+
+					if(!partitions[q])
+						partitions[q] = load_partition(q);
+
+					num_triangles += count_pair(*partitions[p], *partitions[q], fd_out);
+
+					// out of core, only the pair at hand stays loaded
+					if(!in_memory && q != p)
+						partitions[q].reset();
+				}
+
+				if(fd_out != -1)
+					close(fd_out);
+
+				if(!in_memory)
+					partitions[p].reset();
+			}
+
+			return num_triangles;
+		}
+
+		// triangles u -> v -> w, u -> w with u in p and v in q: the common out-neighbors w of u and v.
+		// they are only counted if fd_out is -1, listed to fd_out otherwise
+		long triangle_counting::count_pair(const oriented_partition & p, const oriented_partition & q, int fd_out) {
+			const long chunk_size = 64;
+			std::atomic<long> next_vertex(p.first);
+			std::atomic<long> num_triangles(0);
+
+			std::mutex out_lock;
+
+			std::vector<std::thread> exec_threads;
+			for(int i = 0; i < context.num_exec_threads; i++) {
+				exec_threads.push_back(std::thread([&] {
+					const size_t block_size = IO_SIZE / sizeof(Triangle);
+					std::vector<VertexId> common;
+					std::vector<Triangle> triangles;
+					auto flush = [&] {
+						std::unique_lock<std::mutex> lock(out_lock);
+						io_manager::append_to_file(fd_out, (char*)triangles.data(), triangles.size() * sizeof(Triangle));
+						triangles.clear();
+					};
+
+					long local_count = 0;
+					long chunk_begin;
+					while((chunk_begin = next_vertex.fetch_add(chunk_size)) <= p.last) {
+						long chunk_end = std::min(chunk_begin + chunk_size - 1, (long)p.last);
+						for(VertexId u = chunk_begin; u <= chunk_end; u++) {
+							const VertexId * neighbors_u = p.get_neighbors(u);
+							const long degree_u = p.get_degree(u);
+							if(degree_u < 2)
+								continue;
+
+							// the out-neighbors of u that q holds are a contiguous id range
+							const VertexId * v_begin = std::lower_bound(neighbors_u, neighbors_u + degree_u, q.first);
+							const VertexId * v_end = std::upper_bound(v_begin, neighbors_u + degree_u, q.last);
+							for(const VertexId * v = v_begin; v != v_end; ++v) {
+								const VertexId * neighbors_v = q.get_neighbors(*v);
+								const long degree_v = q.get_degree(*v);
+
+								if(fd_out == -1) {
+									local_count += intersection::count(neighbors_u, degree_u, neighbors_v, degree_v);
+									continue;
+								}
+
+								common.resize(std::min(degree_u, degree_v));
+								long n = intersection::intersect(neighbors_u, degree_u, neighbors_v, degree_v, common.data());
+								for(long k = 0; k < n; k++)
+									triangles.push_back(Triangle(u, *v, common[k]));
+								local_count += n;
+								if(triangles.size() >= block_size)
+									flush();
+							}
+						}
+					}
+
+					if(!triangles.empty())
+						flush();
+					num_triangles += local_count;
+				}));
+			}
+
+			for(auto & t : exec_threads)
+				t.join();
+
+			return num_triangles;
+		}
+
+		void triangle_counting::run_per_partition(std::function<void(int)> work) {
+			concurrent_queue<int> task_queue;
+			for(int partition_id = 0; partition_id < context.num_partitions; partition_id++)
+				task_queue.push(partition_id);
+
+			std::vector<std::thread> threads;
+			for(int i = 0; i < std::min(context.num_exec_threads, context.num_partitions); i++) {
+				threads.push_back(std::thread([&] {
+					int partition_id = -1;
+					while(task_queue.test_pop_atomic(partition_id))
+						work(partition_id);
+				}));
+			}
+
+			for(auto &t : threads)
+				t.join();
+		}
+
+}
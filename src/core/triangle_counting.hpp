@@ -0,0 +1,97 @@
+/*
+ * triangle_counting.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ */
+
+#ifndef CORE_TRIANGLE_COUNTING_HPP_
+#define CORE_TRIANGLE_COUNTING_HPP_
+
+#include "engine.hpp"
+#include "meta_info.hpp"
+#include "intersection.hpp"
+
+namespace RStream {
+
+	// a triangle, its vertices in increasing degree rank
+	struct Triangle {
+		VertexId a;
+		VertexId b;
+		VertexId c;
+
+		Triangle(VertexId _a, VertexId _b, VertexId _c) : a(_a), b(_b), c(_c) {}
+		Triangle() : a(0), b(0), c(0) {}
+	};
+
+	inline std::ostream & operator<<(std::ostream & strm, const Triangle& triangle){
+		strm << "(" << triangle.a << ", " << triangle.b << ", " << triangle.c << ")";
+		return strm;
+	}
+
+	// out-neighbors of the vertices [first, last] of one partition in the oriented graph,
+	// neighbors[offsets[v - first] .. offsets[v - first + 1]) sorted by id
+	struct oriented_partition {
+		VertexId first;
+		VertexId last;
+		std::vector<long> offsets;
+		std::vector<VertexId> neighbors;
+
+		inline const VertexId * get_neighbors(VertexId v) const {
+			return neighbors.data() + offsets[v - first];
+		}
+
+		inline long get_degree(VertexId v) const {
+			return offsets[v - first + 1] - offsets[v - first];
+		}
+	};
+
+	// triangle counting on the degree-oriented graph: every edge points from its endpoint of lower degree
+	// (ties broken by id) to the other, so each vertex keeps few out-neighbors and each triangle u -> v -> w, u -> w
+	// is found exactly once, as a common out-neighbor w of u and v.
+	// the oriented partitions are written once next to the edge partitions; if they all fit in memory_budget
+	// they are counted in memory, otherwise partition pairs (P, Q) are streamed in, Q holding out-neighbors of P.
+	// no wedge is ever materialized.
+	class triangle_counting {
+	public:
+		triangle_counting(Engine & e, long memory_budget = TRIANGLE_MEMORY_BUDGET);
+		~triangle_counting();
+
+		// number of triangles, nothing but the oriented partitions is written to disk
+		long count();
+
+		// every triangle once, as a Triangle, into an update stream of the partition of its vertex a
+		Update_Stream list();
+
+	private:
+		Engine & context;
+		long memory_budget;
+
+		bool oriented;
+		std::vector<long> partition_bytes;
+		// partition_targets[P][Q]: some vertex of P has an out-neighbor in Q
+		std::vector<std::vector<bool>> partition_targets;
+
+		void orient();
+		// triangles are appended to out_stream if list is set, only counted otherwise
+		long run(bool list, Update_Stream out_stream);
+
+		long count_pair(const oriented_partition & p, const oriented_partition & q, int fd_out);
+
+		void build_partition(int partition_id);
+		std::shared_ptr<oriented_partition> load_partition(int partition_id);
+
+		void run_per_partition(std::function<void(int)> work);
+
+		std::string get_oriented_edges_file(int partition_id) {
+			return context.filename + "." + std::to_string(partition_id) + ".oriented";
+		}
+
+		std::string get_partition_file(int partition_id) {
+			return context.filename + "." + std::to_string(partition_id) + ".ocsr";
+		}
+	};
+
+}
+
+#endif /* CORE_TRIANGLE_COUNTING_HPP_ */
@@ -0,0 +1,42 @@
+/*
+ * vertex_view.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ */
+
+#ifndef CORE_VERTEX_VIEW_HPP_
+#define CORE_VERTEX_VIEW_HPP_
+
+#include "../common/RStreamCommon.hpp"
+#include "../struct/type.hpp"
+
+namespace RStream {
+
+	// vertices of a partition are stored contiguously from the first vertex of its interval,
+	// so a vertex is found by its offset from that id; bounds are only checked in debug builds
+	template <typename VertexDataType>
+	class vertex_view {
+		VertexDataType * vertices;
+		VertexId vertex_start;
+		VertexId num_vertices;
+
+	public:
+		vertex_view(char * vertex_local_buf, long vertex_file_size, VertexId _vertex_start)
+			: vertices(reinterpret_cast<VertexDataType*>(vertex_local_buf)), vertex_start(_vertex_start), num_vertices(vertex_file_size / sizeof(VertexDataType)) {
+			assert(vertex_file_size % sizeof(VertexDataType) == 0);
+#ifndef NDEBUG
+			for(VertexId i = 0; i < num_vertices; i++)
+				assert(vertices[i].id == vertex_start + i);
+#endif
+		}
+
+		inline VertexDataType * get(VertexId id) const {
+			assert(id >= vertex_start && id - vertex_start < num_vertices);
+			return vertices + (id - vertex_start);
+		}
+	};
+
+}
+
+#endif /* CORE_VERTEX_VIEW_HPP_ */
@@ -9,6 +9,8 @@
 #define UTILITY_PREPROCESSING_NEW_HPP_
 
 #include "../core/buffer_manager.hpp"
+#include "../core/partition_router.hpp"
+#include "text_parser.hpp"
 
 namespace RStream {
 	class Preprocessing_new {
@@ -24,29 +26,21 @@ namespace RStream {
 
 		int edgeType;
 		int edge_unit;
+		PartitionType partitionType;
+		VertexOrder vertexOrder;
 
-		std::atomic<int> atomic_num_producers;
-		std::atomic<int> atomic_partition_number;
 		int num_exec_threads;
-		int num_write_threads;
-		std::vector<int> degree;
+		std::vector<std::atomic<int>> degree;
 		std::vector<std::pair<VertexId, VertexId>> intervals;
 
 	public:
-		Preprocessing_new(std::string & _input, int _num_partitioins, int _format) : input(_input), format(_format),minVertexId(INT_MAX), maxVertexId(INT_MIN),
-			numPartitions(_num_partitioins), numVertices(0), vertices_per_partition(0), edgeType(0), edge_unit(0){
-			num_exec_threads = 3;
-			num_write_threads = 1;
+		Preprocessing_new(std::string & _input, int _num_partitioins, int _format, PartitionType _partition_type = PartitionType::OnVertices, VertexOrder _vertex_order = VertexOrder::Original) : input(_input), format(_format),minVertexId(INT_MAX), maxVertexId(INT_MIN),
+			numPartitions(_num_partitioins), numVertices(0), vertices_per_partition(0), edgeType(0), edge_unit(0), partitionType(_partition_type), vertexOrder(_vertex_order){
+			num_exec_threads = std::max(std::thread::hardware_concurrency(), 1u);
 
-			atomic_init();
 			run();
 		}
 
-		void atomic_init() {
-			atomic_num_producers = num_exec_threads;
-			atomic_partition_number = numPartitions;
-		}
-
 		void run() {
 			std::cout << "\n\n" << Logger::generate_log_del(std::string("start preprocessing"), 1) << std::endl;
 
@@ -60,9 +54,15 @@ namespace RStream {
 //					std::cout << "convert edge list file done." << std::endl;
 //				}
 
+				if(vertexOrder != VertexOrder::Original)
+					reorder_vertices();
+
 				if(edgeType == (int)EdgeType::NO_WEIGHT) {
 //					std::cout << "start to partition on vertices..." << std::endl;
-					partition_on_vertices<Edge>();
+					if(partitionType == PartitionType::OnEdges)
+						partition_on_edges<Edge>();
+					else
+						partition_on_vertices<Edge>();
 //					std::cout << "partition on vertices done." << std::endl;
 
 //					std::cout << "start to partition on edges..." << std::endl;
@@ -82,8 +82,14 @@ namespace RStream {
 //					std::cout << "convert adj list file done." << std::endl;
 //				}
 
+				if(vertexOrder != VertexOrder::Original)
+					reorder_vertices();
+
 //				std::cout << "start to partition on vertices..." << std::endl;
-				partition_on_vertices<LabeledEdge>();
+				if(partitionType == PartitionType::OnEdges)
+					partition_on_edges<LabeledEdge>();
+				else
+					partition_on_vertices<LabeledEdge>();
 
 //				std::cout << "start to partition on edges..." << std::endl;
 //				partition_on_edges<LabeledEdge>();
@@ -96,194 +102,175 @@ namespace RStream {
 		}
 
 		// note: vertex id always starts with 0
+		// the text is mapped and cut into chunks of lines, parsed in parallel into blocks of binary edges with
+		// their min and max ids. the blocks are then rebased on the min id, counted into degree and written at
+		// their offsets in .binary. text beyond PREPROCESSING_MEMORY_BUDGET is parsed in windows whose blocks
+		// are written as they are, and .binary is rebased in place afterwards.
 		void convert_edgelist() {
-			FILE * fd = fopen(input.c_str(), "r");
-			assert(fd != NULL );
-			char * buf = (char *)memalign(PAGE_SIZE, IO_SIZE);
-			long pos = 0;
+			mapped_text text(input);
 
-			long counter = 0;
-			char s[1024];
-			while(fgets(s, 1024, fd) != NULL) {
-				if (s[0] == '#') continue; // Comment
-				if (s[0] == '%') continue; // Comment
-
-				char delims[] = "\t, ";
-				char * t;
-				t = strtok(s, delims);
-				assert(t != NULL);
-
-				VertexId from = atoi(t);
-				t = strtok(NULL, delims);
-				assert(t != NULL);
-				VertexId to = atoi(t);
-
-				minVertexId = std::min(minVertexId, from);
-				minVertexId = std::min(minVertexId, to);
-				maxVertexId = std::max(maxVertexId, from);
-				maxVertexId = std::max(maxVertexId, to);
+			if(is_weighted(text)) {
+				edgeType = (int)EdgeType::WITH_WEIGHT;
+				edge_unit = sizeof(VertexId) * 2 + sizeof(Weight);
+			} else {
+				edgeType = (int)EdgeType::NO_WEIGHT;
+				edge_unit = sizeof(VertexId) * 2;
 			}
-			numVertices = maxVertexId - minVertexId + 1;
-			degree = std::vector<int>(numVertices);
-
-			fclose(fd);
-			fd = fopen(input.c_str(), "r");
-			while(fgets(s, 1024, fd) != NULL) {
-				if (s[0] == '#') continue; // Comment
-				if (s[0] == '%') continue; // Comment
-
-				char delims[] = "\t, ";
-				char * t;
-				t = strtok(s, delims);
-				assert(t != NULL);
-
-				VertexId from = atoi(t);
-				from -= minVertexId;
-				t = strtok(NULL, delims);
-				assert(t != NULL);
-				VertexId to = atoi(t);
-				to -= minVertexId;
-
-				if(from == to) continue;
-
-				degree.at(from)++;
-
-//				void * data = nullptr;
-				Weight val;
-				/* Check if has value */
-				t = strtok(NULL, delims);
-				if(t != NULL) {
-					val = atof(t);
-//					data = new WeightedEdge(from, to, val);
-					WeightedEdge * wedge = new WeightedEdge(from, to, val);
-					edge_unit = sizeof(VertexId) * 2 + sizeof(Weight);
-//					std::memcpy(buf + pos, data, edge_unit);
-					std::memcpy(buf + pos, (void*)wedge, edge_unit);
-					pos += edge_unit;
-					edgeType = (int)EdgeType::WITH_WEIGHT;
-					delete wedge;
 
-				} else {
-//					data = new Edge(from, to);
-					Edge * edge = new Edge(from, to);
-					edge_unit =  sizeof(VertexId) * 2;
-//					std::memcpy(buf + pos, data, edge_unit);
-					std::memcpy(buf + pos, (void*)edge, edge_unit);
-					pos += edge_unit;
-					edgeType = (int)EdgeType::NO_WEIGHT;
-					delete edge;
+			std::vector<long> bounds = text.split_lines(CHUNK_SIZE);
+			int num_chunks = bounds.size() - 1;
+			std::vector<std::vector<char>> blocks(num_chunks);
+			std::vector<VertexId> chunk_min(num_chunks, INT_MAX), chunk_max(num_chunks, INT_MIN);
 
+			int fout = open((input + ".binary").c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRWXU);
+			assert(fout > 0);
+
+			long binary_size = 0;
+			bool spilled = false;
+			for(int window_begin = 0; window_begin < num_chunks; ) {
+				int window_end = get_window_end(bounds, window_begin);
+
+				run_parallel(window_end - window_begin, [&](int task) {
+					int i = window_begin + task;
+					parse_edgelist_chunk(text.data() + bounds[i], text.data() + bounds[i + 1], blocks[i], chunk_min[i], chunk_max[i]);
+				});
+
+				// more input than one window: blocks are written as parsed, and rebased in place at the end
+				if(window_end < num_chunks || spilled) {
+					binary_size = write_blocks(fout, blocks, window_begin, window_end, binary_size, false);
+					spilled = true;
 				}
-				counter++;
-//				if(counter % 1000000 == 0)
-//					std::cout << "Processing " << counter << " lines " << std::endl;
-
-				assert(IO_SIZE % edge_unit == 0);
-				if(pos >= IO_SIZE) {
-					int perms = O_WRONLY | O_APPEND;
-					int fout = open((input + ".binary").c_str(), perms, S_IRWXU);
-					if(fout < 0){
-						fout = creat((input + ".binary").c_str(), S_IRWXU);
-					}
-					io_manager::write_to_file(fout, buf, IO_SIZE);
-					counter -= IO_SIZE / edge_unit;
-					close(fout);
-					pos = 0;
-				}
+				window_begin = window_end;
+			}
 
+			for(int i = 0; i < num_chunks; i++) {
+				minVertexId = std::min(minVertexId, chunk_min[i]);
+				maxVertexId = std::max(maxVertexId, chunk_max[i]);
 			}
+			numVertices = maxVertexId - minVertexId + 1;
+			std::vector<std::atomic<int>>(numVertices).swap(degree);
 
-			int perms = O_WRONLY | O_APPEND;
-			int fout = open((input + ".binary").c_str(), perms, S_IRWXU);
-			if(fout < 0){
-				fout = creat((input + ".binary").c_str(), S_IRWXU);
+			// the whole input fits, its blocks are written once rebased
+			if(!spilled) {
+				write_blocks(fout, blocks, 0, num_chunks, 0, true);
+			} else {
+				update_binary(fout, binary_size, [&](char * buf, long length) {
+					rebase_edges(buf, length);
+					return minVertexId != 0;
+				});
 			}
 
-			io_manager::write_to_file(fout, buf, counter * edge_unit);
 			close(fout);
-			free(buf);
-
-			fclose(fd);
 		};
 
 		// note: vertex id always starts with 0
 		// (int)src, (int)target, (BYTE)src_label, (BYTE)target_label
+		// a line is a vertex, its label and its neighbors. chunks of lines are parsed in parallel twice: once
+		// for the vertex labels and id range, then for the edges, each line's neighbors deduplicated with
+		// sort + unique on a reused vector and the edges of a chunk gathered into one block. blocks of
+		// PREPROCESSING_MEMORY_BUDGET bytes of text at a time are written at their offsets in .binary.
 		void convert_adjlist() {
 			edgeType = (int)EdgeType::Labeled;
 			edge_unit = sizeof(VertexId) * 2 + sizeof(BYTE) * 2;
 
-			FILE* fd = fopen(input.c_str(), "r");
-			assert(fd != NULL);
-			
-			char buf[2048], delims[] = "\t ";
-			VertexId vert, oldVert = -1;
-			BYTE val;
-			int count = 0, size = 0, maxsize = 0;
-			std::vector<BYTE> vertLabels;
-			while (fgets(buf, 2048, fd) != NULL) {
-				int len = strlen(buf);
-				if (size == 0) {
-					vert = std::stoi(strtok(buf, delims));
-					val = (BYTE)(std::stoi(strtok(NULL, delims)));
-					
-					if (count != 0 && oldVert != (vert-1)) {
-						for (int n = oldVert+1; n < vert; n++) {
-							vertLabels.push_back(0);
-							count++;
-						}
+			mapped_text text(input);
+			std::vector<long> bounds = text.split_lines(CHUNK_SIZE);
+			int num_chunks = bounds.size() - 1;
+
+			// vertices with their labels, per chunk
+			std::vector<std::vector<std::pair<VertexId, BYTE>>> chunk_vertices(num_chunks);
+			run_parallel(num_chunks, [&](int i) {
+				const char * p = text.data() + bounds[i], * end = text.data() + bounds[i + 1];
+				while(p != end) {
+					const char * eol = text_parser::get_line_end(p, end);
+					if(!text_parser::is_comment(p, eol) && text_parser::next_field(p, eol)) {
+						VertexId vert = text_parser::parse_vertex(p, eol);
+						chunk_vertices[i].push_back(std::make_pair(vert, text_parser::parse_label(p, eol)));
 					}
-					minVertexId = std::min(minVertexId, vert);
-					vertLabels.push_back(val);
-					count++;
-					oldVert = vert;
+					p = eol == end ? end : eol + 1;
 				}
+			});
 
-				size += len;
-				if (buf[len-1] == '\n') {
-					maxsize = std::max(size, maxsize);
-					size = 0;
+			for(int i = 0; i < num_chunks; i++) {
+				for(auto & vertex : chunk_vertices[i]) {
+					minVertexId = std::min(minVertexId, vertex.first);
+					maxVertexId = std::max(maxVertexId, vertex.first);
 				}
 			}
-			fclose(fd);
-
-			numVertices = count;
-			degree = std::vector<int>(numVertices);
-
-			fd = fopen(input.c_str(), "r");
-			assert(fd != NULL);
-			FILE* output = fopen((input + ".binary").c_str(), "wb");
-			assert(output != NULL);
-			char* adj_list = new char[maxsize+1];
-			while (fgets(adj_list, maxsize+1, fd) != NULL) {
-				int len = strlen(adj_list);
-				adj_list[len-1] = 0;
-				VertexId src = std::stoi(strtok(adj_list, delims));
-				BYTE srcLab = (BYTE)(std::stoi(strtok(NULL, delims)));
-
-				std::set<VertexId> neighbors;
-				char* strp;
-				while ((strp = strtok(NULL, delims)) != NULL) {
-					VertexId tgt = std::stoi(strp);
-					if (src == tgt) continue;
-					neighbors.insert(tgt-minVertexId);
-				}
+			numVertices = maxVertexId - minVertexId + 1;
+			std::vector<std::atomic<int>>(numVertices).swap(degree);
+
+			// vertices without a line of their own are labeled 0
+			std::vector<BYTE> vertLabels(numVertices, 0);
+			for(int i = 0; i < num_chunks; i++) {
+				for(auto & vertex : chunk_vertices[i])
+					vertLabels[vertex.first - minVertexId] = vertex.second;
+				std::vector<std::pair<VertexId, BYTE>>().swap(chunk_vertices[i]);
+			}
 
-				maxVertexId = std::max(maxVertexId, src);
-				src -= minVertexId;
-				degree.at(src) = neighbors.size();
-
-				for (std::set<VertexId>::iterator iter = neighbors.begin(); iter != neighbors.end(); iter++) {
-					BYTE tgtLab = vertLabels[*iter];
-					VertexId tgt = *iter;
-					fwrite((const void*) &src, sizeof(VertexId), 1, output);
-					fwrite((const void*) &tgt, sizeof(VertexId), 1, output);
-					fwrite((const void*) &srcLab, sizeof(BYTE), 1, output);
-					fwrite((const void*) &tgtLab, sizeof(BYTE), 1, output);
-				}
+			int fout = open((input + ".binary").c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
+			assert(fout > 0);
+
+			std::vector<std::vector<char>> blocks(num_chunks);
+			long binary_size = 0;
+			for(int window_begin = 0; window_begin < num_chunks; ) {
+				int window_end = get_window_end(bounds, window_begin);
+
+				run_parallel(window_end - window_begin, [&](int task) {
+					int i = window_begin + task;
+					parse_adjlist_chunk(text.data() + bounds[i], text.data() + bounds[i + 1], vertLabels, blocks[i]);
+				});
+
+				binary_size = write_blocks(fout, blocks, window_begin, window_end, binary_size, false);
+				window_begin = window_end;
 			}
 
-			fclose(fd);
-			fclose(output);
+			close(fout);
+		}
+
+		// relabels the vertices of .binary by decreasing degree, ties by id. hubs, whose edges and vertex data the
+		// joins probe most, then share the first pages and cache lines of every id-indexed array, and the low
+		// partitions. the original id of every new id is kept in the .order file, see Engine::get_original_id
+		void reorder_vertices() {
+			std::vector<VertexId> order(numVertices);
+			for(VertexId v = 0; v < numVertices; v++)
+				order[v] = v;
+			std::stable_sort(order.begin(), order.end(), [this](VertexId a, VertexId b) { return degree[a] > degree[b]; });
+
+			std::vector<VertexId> new_ids(numVertices);
+			for(VertexId v = 0; v < numVertices; v++)
+				new_ids[order[v]] = v;
+
+			int fd = open((input + ".binary").c_str(), O_RDWR);
+			assert(fd > 0);
+			update_binary(fd, io_manager::get_filesize(fd), [&](char * buf, long length) {
+				for(long pos = 0; pos < length; pos += edge_unit) {
+					VertexId * edge = (VertexId*)(buf + pos);
+					edge[0] = new_ids[edge[0]];
+					edge[1] = new_ids[edge[1]];
+				}
+				return true;
+			});
+			close(fd);
+
+			// degrees follow their vertices, for partition_on_edges
+			std::vector<std::atomic<int>> new_degree(numVertices);
+			for(VertexId v = 0; v < numVertices; v++)
+				new_degree[v] = degree[order[v]].load();
+			degree.swap(new_degree);
+
+			// original ids as they are in the input, before the min id was subtracted
+			for(VertexId v = 0; v < numVertices; v++)
+				order[v] += minVertexId;
+			int fd_order = open(get_order_file(input).c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
+			assert(fd_order > 0);
+			io_manager::write_to_file(fd_order, (char*)order.data(), order.size() * sizeof(VertexId));
+			close(fd_order);
+		}
+
+		// the original id of every vertex id, written by reorder_vertices
+		static std::string get_order_file(const std::string & input) {
+			return input + ".order";
 		}
 
 		template<typename T>
@@ -312,127 +299,39 @@ namespace RStream {
 				}
 			}
 
-			int fd = open((input + ".binary").c_str(), O_RDONLY);
-			assert(fd > 0 );
-
-			// get file size
-			long file_size = io_manager::get_filesize(fd);
-			int streaming_counter = file_size / (IO_SIZE * sizeof(T)) + 1;
-			long valid_io_size = 0;
-			long offset = 0;
-
-			concurrent_queue<std::tuple<int, long, long>> * task_queue = new concurrent_queue<std::tuple<int, long, long>>(65536);
-			// <fd, offset, length>
-			for(int counter = 0; counter < streaming_counter; counter++) {
-				if(counter == streaming_counter - 1)
-					// TODO: potential overflow?
-//					valid_io_size = file_size - IO_SIZE * (streaming_counter - 1);
-					valid_io_size = file_size - IO_SIZE * sizeof(T) * (streaming_counter - 1);
-				else
-//					valid_io_size = IO_SIZE;
-					valid_io_size = IO_SIZE * sizeof(T);
-
-				task_queue->push(std::make_tuple(fd, offset, valid_io_size));
-				offset += valid_io_size;
-			}
-
-			global_buffer<T> ** buffers_for_shuffle = buffer_manager<T>::get_global_buffers(numPartitions);
-
-			std::vector<std::thread> exec_threads;
-			for(int i = 0; i < num_exec_threads; i++)
-				exec_threads.push_back( std::thread([=] { this->producer_partition_on_vertices<T>(buffers_for_shuffle, task_queue); } ));
-
-			std::vector<std::thread> write_threads;
-			for(int i = 0; i < num_write_threads; i++)
-				write_threads.push_back(std::thread(&Preprocessing_new::consumer<T>, this, buffers_for_shuffle));
-
-			// join all threads
-			for(auto & t : exec_threads)
-				t.join();
-
-			for(auto &t : write_threads)
-				t.join();
-
-			delete[] buffers_for_shuffle;
-			delete task_queue;
-			close(fd);
-
+			partition_by_src<T>();
 		};
 
+		// intervals of about equal out-degree sums, so that partitions hold about as many edges on power-law graphs.
+		// an interval ends at the vertex that brings its sum closest to its share, keeping a vertex for every later one
 		template <typename T>
 		void partition_on_edges() {
-			int fd = open((input + ".binary").c_str(), O_RDONLY);
-			assert(fd > 0 );
+			assert(numVertices >= numPartitions);
+			vertices_per_partition = numVertices / numPartitions;
 
-			// get file size
-			long file_size = io_manager::get_filesize(fd);
-			// get num of edges
-			long numEdges = file_size / sizeof(T);
-			long edges_per_part = numEdges / numPartitions;
+			long numEdges = 0;
+			for(int i = 0; i < numVertices; i++)
+				numEdges += degree[i];
 
-			long counter = 0;
 			VertexId intvalStart = 0;
-
-			// gen vertex interval info
-			for(unsigned int i = 0; i < degree.size(); i++) {
-				counter += degree.at(i);
-				if(counter >= edges_per_part) {
-					intervals.push_back(std::make_pair(intvalStart, i - 1));
-					intvalStart = i;
-					counter = 0;
-
-				}
-				if(intervals.size() == numPartitions - 1) {
-					intervals.push_back(std::make_pair(i, degree.size() - 1));
-				}
+			long counter = 0;
+			for(int i = 0; i < numPartitions - 1; i++) {
+				long share = numEdges * (i + 1) / numPartitions;
+				VertexId intvalEnd = intvalStart;
+				counter += degree[intvalEnd];
+				while(intvalEnd + 1 < numVertices - (numPartitions - 1 - i) && counter + degree[intvalEnd + 1] / 2 < share)
+					counter += degree[++intvalEnd];
+
+				intervals.push_back(std::make_pair(intvalStart, intvalEnd));
+				intvalStart = intvalEnd + 1;
 			}
-			assert(intervals.size() == numPartitions);
+			intervals.push_back(std::make_pair(intvalStart, numVertices - 1));
 
 			for(unsigned int i = 0; i < intervals.size(); i++) {
 				std::cout << "interval " << i << " [ " << intervals.at(i).first << " , " << intervals.at(i).second << " ]" << std::endl;
 			}
 
-			int streaming_counter = file_size / (IO_SIZE * sizeof(T)) + 1;
-			long valid_io_size = 0;
-			long offset = 0;
-
-			concurrent_queue<std::tuple<int, long, long>> * task_queue = new concurrent_queue<std::tuple<int, long, long>>(65536);
-			// <fd, offset, length>
-			for(int counter = 0; counter < streaming_counter; counter++) {
-				if(counter == streaming_counter - 1)
-					// TODO: potential overflow?
-//					valid_io_size = file_size - IO_SIZE * (streaming_counter - 1);
-					valid_io_size = file_size - IO_SIZE * sizeof(T) * (streaming_counter - 1);
-				else
-//					valid_io_size = IO_SIZE;
-					valid_io_size = IO_SIZE * sizeof(T);
-
-				task_queue->push(std::make_tuple(fd, offset, valid_io_size));
-				offset += valid_io_size;
-			}
-
-			global_buffer<T> ** buffers_for_shuffle = buffer_manager<T>::get_global_buffers(numPartitions);
-
-			std::vector<std::thread> exec_threads;
-			for(int i = 0; i < num_exec_threads; i++)
-				exec_threads.push_back( std::thread([=] { this->producer_partition_on_edges<T>(buffers_for_shuffle, task_queue); } ));
-
-			std::vector<std::thread> write_threads;
-			for(int i = 0; i < num_write_threads; i++)
-				write_threads.push_back(std::thread(&Preprocessing_new::consumer<T>, this, buffers_for_shuffle));
-
-			// join all threads
-			for(auto & t : exec_threads)
-				t.join();
-
-			for(auto &t : write_threads)
-				t.join();
-
-			delete[] buffers_for_shuffle;
-			delete task_queue;
-			close(fd);
-
-
+			partition_by_src<T>();
 		};
 
 		void write_meta_file() {
@@ -466,255 +365,237 @@ namespace RStream {
 
 
 	private:
-		template<typename T>
-		void producer_partition_on_vertices(global_buffer<T> ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long> > * task_queue) {
-			int fd = -1;
-			long offset = 0, length = 0;
-			auto one_task = std::make_tuple(fd, offset, length);
-
-			VertexId src = 0, dst = 0;
-			Weight weight = 0.0f;
-			BYTE src_label, dst_label;
-			char * local_buf = (char*)memalign(PAGE_SIZE, IO_SIZE * sizeof(T));
-
-			// pop from queue
-			while(task_queue->test_pop_atomic(one_task)){
-				fd = std::get<0>(one_task);
-				offset = std::get<1>(one_task);
-				length = std::get<2>(one_task);
-
-//				char * local_buf = (char*)memalign(PAGE_SIZE, IO_SIZE * sizeof(T));
-//				int streaming_counter = length / (IO_SIZE * sizeof(T)) + 1;
-
-				assert((length % sizeof(T)) == 0);
-				io_manager::read_from_file(fd, local_buf, length, offset);
-
-				for(long pos = 0; pos < length; pos += sizeof(T)) {
-					src = *(VertexId*)(local_buf + pos);
-					dst = *(VertexId*)(local_buf + pos + sizeof(VertexId));
-					assert(src >= 0 && src < numVertices && dst >= 0 && dst < numVertices);
-
-//					void * data = nullptr;
-					if(typeid(T) == typeid(Edge)) {
-//						data = new Edge(src, dst);
-						Edge * data = new Edge(src, dst);
-
-						int index = get_index_partition_vertices(src);
-
-						global_buffer<T>* global_buf = buffer_manager<T>::get_global_buffer(buffers_for_shuffle, numPartitions, index);
-						global_buf->insert((T*)data, index);
-
-						delete data;
-
-					} else if(typeid(T) == typeid(WeightedEdge)) {
-						weight = *(Weight*)(local_buf + pos + sizeof(VertexId) * 2);
-//						data = new WeightedEdge(src, dst, weight);
-						WeightedEdge * data = new WeightedEdge(src, dst, weight);
-
-						int index = get_index_partition_vertices(src);
-
-						global_buffer<T>* global_buf = buffer_manager<T>::get_global_buffer(buffers_for_shuffle, numPartitions, index);
-						global_buf->insert((T*)data, index);
-
-						delete data;
+		// runs work(0) .. work(num_tasks - 1) on num_exec_threads threads
+		void run_parallel(int num_tasks, std::function<void(int)> work) {
+			std::atomic<int> next_task(0);
+			std::vector<std::thread> threads;
+			for(int i = 0; i < std::min(num_exec_threads, num_tasks); i++)
+				threads.push_back(std::thread([&] {
+					int task;
+					while((task = next_task++) < num_tasks)
+						work(task);
+				}));
+
+			for(auto & t : threads)
+				t.join();
+		}
 
+		// an edge list is weighted if its first edge has a third field
+		bool is_weighted(const mapped_text & text) {
+			const char * p = text.data(), * end = text.data() + text.size();
+			while(p != end) {
+				const char * eol = text_parser::get_line_end(p, end);
+				if(!text_parser::is_comment(p, eol) && text_parser::next_field(p, eol)) {
+					text_parser::parse_vertex(p, eol);
+					text_parser::parse_vertex(p, eol);
+					return text_parser::next_field(p, eol);
+				}
+				p = eol == end ? end : eol + 1;
+			}
+			return false;
+		}
 
-					} else if(typeid(T) == typeid(LabeledEdge)) {
-						src_label = *(BYTE*)(local_buf + pos + sizeof(VertexId) * 2);
-						dst_label = *(BYTE*)(local_buf + pos + sizeof(VertexId) * 2 + sizeof(BYTE));
-//						data = new LabeledEdge(src, dst, src_label, dst_label);
-						LabeledEdge * data = new LabeledEdge(src, dst, src_label, dst_label);
+		// chunks [window_begin, window_end) hold at most PREPROCESSING_MEMORY_BUDGET bytes of text, or a single chunk
+		int get_window_end(const std::vector<long> & bounds, int window_begin) {
+			int window_end = window_begin + 1;
+			while(window_end < (int)bounds.size() - 1 && bounds[window_end + 1] - bounds[window_begin] <= PREPROCESSING_MEMORY_BUDGET)
+				window_end++;
+			return window_end;
+		}
 
-						int index = get_index_partition_vertices(src);
+		// appends the edges of the lines in [p, end) to block with their original ids, self loops dropped
+		void parse_edgelist_chunk(const char * p, const char * end, std::vector<char> & block, VertexId & min_id, VertexId & max_id) {
+			const bool weighted = edgeType == (int)EdgeType::WITH_WEIGHT;
+			std::vector<char> local_buf(LOCAL_BUFFER_SIZE / edge_unit * edge_unit);
+			long pos = 0;
 
-						global_buffer<T>* global_buf = buffer_manager<T>::get_global_buffer(buffers_for_shuffle, numPartitions, index);
-						global_buf->insert((T*)data, index);
+			while(p != end) {
+				const char * eol = text_parser::get_line_end(p, end);
+				if(!text_parser::is_comment(p, eol) && text_parser::next_field(p, eol)) {
+					VertexId from = text_parser::parse_vertex(p, eol);
+					VertexId to = text_parser::parse_vertex(p, eol);
+					min_id = std::min(min_id, std::min(from, to));
+					max_id = std::max(max_id, std::max(from, to));
+
+					if(from != to) {
+						std::memcpy(local_buf.data() + pos, &from, sizeof(VertexId));
+						std::memcpy(local_buf.data() + pos + sizeof(VertexId), &to, sizeof(VertexId));
+						if(weighted) {
+							Weight val = text_parser::parse_weight(p, eol);
+							std::memcpy(local_buf.data() + pos + sizeof(VertexId) * 2, &val, sizeof(Weight));
+						}
+						pos += edge_unit;
 
-						delete data;
+						if(pos == (long)local_buf.size()) {
+							block.insert(block.end(), local_buf.begin(), local_buf.end());
+							pos = 0;
+						}
 					}
-
-//					int index = get_index_partition_vertices(src);
-//
-//					global_buffer<T>* global_buf = buffer_manager<T>::get_global_buffer(buffers_for_shuffle, numPartitions, index);
-//					global_buf->insert((T*)data, index);
-
 				}
-
-
-//				long valid_io_size = 0;
-//				long off = offset;
-//				// for all streaming
-//				for(int counter = 0; counter < streaming_counter; counter++) {
-//					if(counter == streaming_counter - 1)
-//						// TODO: potential overflow?
-//						valid_io_size = length - IO_SIZE * sizeof(T) * (streaming_counter - 1);
-//					else
-//						valid_io_size = IO_SIZE * sizeof(T);
-//
-//					assert(valid_io_size % sizeof(T) == 0);
-//
-//					io_manager::read_from_file(fd, local_buf, length, off);
-//					off += valid_io_size;
-//
-//					for(long pos = 0; pos < valid_io_size; pos += sizeof(T)) {
-//						src = *(VertexId*)(local_buf + pos);
-//						dst = *(VertexId*)(local_buf + pos + sizeof(VertexId));
-//						assert(src >= 0 && src < numVertices && dst >= 0 && dst < numVertices);
-//
-//						void * data = nullptr;
-//						if(typeid(T) == typeid(Edge)) {
-//							data = new Edge(src, dst);
-//						} else if(typeid(T) == typeid(WeightedEdge)) {
-//							weight = *(Weight*)(local_buf + pos + sizeof(VertexId) * 2);
-//							data = new WeightedEdge(src, dst, weight);
-//						} else if(typeid(T) == typeid(LabeledEdge)) {
-//							src_label = *(BYTE*)(local_buf + pos + sizeof(VertexId) * 2);
-//							dst_label = *(BYTE*)(local_buf + pos + sizeof(VertexId) * 2 + sizeof(BYTE));
-//							data = new LabeledEdge(src, dst, src_label, dst_label);
-//						}
-//
-//						int index = get_index_partition_vertices(src);
-//
-//						global_buffer<T>* global_buf = buffer_manager<T>::get_global_buffer(buffers_for_shuffle, numPartitions, index);
-//						global_buf->insert((T*)data, index);
-//
-//					}
-//
-//				}
-
+				p = eol == end ? end : eol + 1;
 			}
 
-			free(local_buf);
-			atomic_num_producers--;
+			block.insert(block.end(), local_buf.begin(), local_buf.begin() + pos);
 		}
 
-		template<typename T>
-		void producer_partition_on_edges(global_buffer<T> ** buffers_for_shuffle, concurrent_queue<std::tuple<int, long, long> > * task_queue) {
-			int fd = -1;
-			long offset = 0, length = 0;
-			auto one_task = std::make_tuple(fd, offset, length);
-
-			VertexId src = 0, dst = 0;
-			Weight weight = 0.0f;
-			BYTE src_label, dst_label;
-			char * local_buf = (char*)memalign(PAGE_SIZE, IO_SIZE * sizeof(T));
-
-			// pop from queue
-			while(task_queue->test_pop_atomic(one_task)){
-				fd = std::get<0>(one_task);
-				offset = std::get<1>(one_task);
-				length = std::get<2>(one_task);
-
-//				char * local_buf = (char*)memalign(PAGE_SIZE, IO_SIZE * sizeof(T));
-//				int streaming_counter = length / (IO_SIZE * sizeof(T)) + 1;
-
-				assert((length % sizeof(T)) == 0);
-				io_manager::read_from_file(fd, local_buf, length, offset);
-
-				for(long pos = 0; pos < length; pos += sizeof(T)) {
-					src = *(VertexId*)(local_buf + pos);
-					dst = *(VertexId*)(local_buf + pos + sizeof(VertexId));
-					assert(src >= 0 && src < numVertices && dst >= 0 && dst < numVertices);
-
-//					void * data = nullptr;
-					if(typeid(T) == typeid(Edge)) {
-//						data = new Edge(src, dst);
-						Edge * data = new Edge(src, dst);
-
-						int index = get_index_partition_edges(src);
-						assert(index >= 0);
-
-						global_buffer<T>* global_buf = buffer_manager<T>::get_global_buffer(buffers_for_shuffle, numPartitions, index);
-						global_buf->insert((T*)data, index);
-
-						delete data;
-
-					} else if(typeid(T) == typeid(WeightedEdge)) {
-						weight = *(Weight*)(local_buf + pos + sizeof(VertexId) * 2);
-//						data = new WeightedEdge(src, dst, weight);
-						WeightedEdge * data = new WeightedEdge(src, dst, weight);
-
-						int index = get_index_partition_edges(src);
-						assert(index >= 0);
-
-						global_buffer<T>* global_buf = buffer_manager<T>::get_global_buffer(buffers_for_shuffle, numPartitions, index);
-						global_buf->insert((T*)data, index);
-
-						delete data;
-
-					} else if(typeid(T) == typeid(LabeledEdge)) {
-						src_label = *(BYTE*)(local_buf + pos + sizeof(VertexId) * 2);
-						dst_label = *(BYTE*)(local_buf + pos + sizeof(VertexId) * 2 + sizeof(BYTE));
-//						data = new LabeledEdge(src, dst, src_label, dst_label);
-						LabeledEdge * data = new LabeledEdge(src, dst, src_label, dst_label);
+		// appends the labeled edges of the adjacency lines in [p, end) to block, ids rebased, and sets the degrees of their vertices
+		void parse_adjlist_chunk(const char * p, const char * end, const std::vector<BYTE> & vertLabels, std::vector<char> & block) {
+			std::vector<char> local_buf(LOCAL_BUFFER_SIZE / edge_unit * edge_unit);
+			long pos = 0;
+			std::vector<VertexId> neighbors;
+
+			while(p != end) {
+				const char * eol = text_parser::get_line_end(p, end);
+				if(!text_parser::is_comment(p, eol) && text_parser::next_field(p, eol)) {
+					VertexId src = text_parser::parse_vertex(p, eol);
+					BYTE srcLab = text_parser::parse_label(p, eol);
+
+					neighbors.clear();
+					while(text_parser::next_field(p, eol)) {
+						VertexId tgt = text_parser::parse_vertex(p, eol);
+						if(src == tgt) continue;
+						assert(tgt >= minVertexId && tgt <= maxVertexId);
+						neighbors.push_back(tgt - minVertexId);
+					}
+					std::sort(neighbors.begin(), neighbors.end());
+					neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
 
-						int index = get_index_partition_edges(src);
-						assert(index >= 0);
+					src -= minVertexId;
+					degree[src] = neighbors.size();
 
-						global_buffer<T>* global_buf = buffer_manager<T>::get_global_buffer(buffers_for_shuffle, numPartitions, index);
-						global_buf->insert((T*)data, index);
+					for(VertexId tgt : neighbors) {
+						LabeledEdge edge(src, tgt, srcLab, vertLabels[tgt]);
+						std::memcpy(local_buf.data() + pos, &edge, edge_unit);
+						pos += edge_unit;
 
-						delete data;
+						if(pos == (long)local_buf.size()) {
+							block.insert(block.end(), local_buf.begin(), local_buf.end());
+							pos = 0;
+						}
 					}
+				}
+				p = eol == end ? end : eol + 1;
+			}
 
-//					int index = get_index_partition_edges(src);
-//					assert(index >= 0);
-//
-//					global_buffer<T>* global_buf = buffer_manager<T>::get_global_buffer(buffers_for_shuffle, numPartitions, index);
-//					global_buf->insert((T*)data, index);
+			block.insert(block.end(), local_buf.begin(), local_buf.begin() + pos);
+		}
 
-				}
+		// runs update on ranges of whole edges of the first size bytes of .binary in parallel, and writes back the ranges it changed
+		void update_binary(int fd, long size, std::function<bool(char*, long)> update) {
+			assert(size % edge_unit == 0);
+			const long io_size = IO_SIZE / edge_unit * edge_unit;
+			int num_ranges = (size + io_size - 1) / io_size;
+			run_parallel(num_ranges, [&](int i) {
+				long offset = i * io_size;
+				long length = std::min(io_size, size - offset);
+				std::vector<char> buf(length);
+				io_manager::read_from_file(fd, buf.data(), length, offset);
+				if(update(buf.data(), length))
+					io_manager::write_to_file(fd, buf.data(), length, offset);
+			});
+		}
 
+		// shifts the ids of the edges in buf to start at 0 and counts their out-degrees
+		void rebase_edges(char * buf, long length) {
+			assert(length % edge_unit == 0);
+			for(long pos = 0; pos < length; pos += edge_unit) {
+				VertexId * edge = (VertexId*)(buf + pos);
+				edge[0] -= minVertexId;
+				edge[1] -= minVertexId;
+				degree[edge[0]].fetch_add(1, std::memory_order_relaxed);
 			}
+		}
 
-			free(local_buf);
-			atomic_num_producers--;
+		// writes blocks [begin, end) one after another from offset on, in parallel, and frees them. returns the end offset
+		long write_blocks(int fd, std::vector<std::vector<char>> & blocks, int begin, int end, long offset, bool rebase) {
+			std::vector<long> offsets(end - begin + 1, offset);
+			for(int i = begin; i < end; i++)
+				offsets[i - begin + 1] = offsets[i - begin] + blocks[i].size();
+
+			run_parallel(end - begin, [&](int task) {
+				std::vector<char> & block = blocks[begin + task];
+				if(rebase)
+					rebase_edges(block.data(), block.size());
+				io_manager::write_to_file(fd, block.data(), block.size(), offsets[task]);
+				std::vector<char>().swap(block);
+			});
+
+			return offsets.back();
 		}
 
+		// edges go to the interval of their src by a counting sort over chunks of .binary.
+		// pass 1 counts the edges of every chunk for every partition, which fixes where the edges of each chunk
+		// start in each partition file; pass 2 groups every chunk by partition and pwrites the groups there.
+		// tasks share nothing but the counts, and every partition keeps the order of .binary.
 		template<typename T>
-		void consumer(global_buffer<T> ** buffers_for_shuffle) {
-			int counter = 0;
+		void partition_by_src() {
+			partition_router router;
+			router.build(intervals);
 
-			while(atomic_num_producers != 0) {
-				if(counter == numPartitions)
-					counter = 0;
+			int fd = open((input + ".binary").c_str(), O_RDONLY);
+			assert(fd > 0);
+			long file_size = io_manager::get_filesize(fd);
+			assert(file_size % sizeof(T) == 0);
+
+			const long chunk_size = IO_SIZE / sizeof(T) * sizeof(T);
+			int num_chunks = (file_size + chunk_size - 1) / chunk_size;
+
+			// counts[c * numPartitions + p]: edges of chunk c in partition p, after pass 1 their offset in partition p
+			std::vector<long> counts((long)num_chunks * numPartitions, 0);
+			run_parallel(num_chunks, [&](int c) {
+				long length = std::min(chunk_size, file_size - c * chunk_size);
+				std::vector<T> edges(length / sizeof(T));
+				io_manager::read_from_file(fd, (char*)edges.data(), length, c * chunk_size);
+
+				long * count = counts.data() + (long)c * numPartitions;
+				for(const T & e : edges) {
+					assert(e.src >= 0 && e.src < numVertices && e.target >= 0 && e.target < numVertices);
+					count[router.get_index(e.src)]++;
+				}
+			});
+
+			for(int p = 0; p < numPartitions; p++) {
+				long offset = 0;
+				for(int c = 0; c < num_chunks; c++) {
+					long count = counts[(long)c * numPartitions + p];
+					counts[(long)c * numPartitions + p] = offset;
+					offset += count * sizeof(T);
+				}
+			}
 
-				int i = counter++;
-				std::string file_name = (input + "." + std::to_string(i));
-				global_buffer<T>* g_buf = buffer_manager<T>::get_global_buffer(buffers_for_shuffle, numPartitions, i);
-				g_buf->flush(file_name, i);
+			std::vector<int> fds(numPartitions);
+			for(int p = 0; p < numPartitions; p++) {
+				fds[p] = open((input + "." + std::to_string(p)).c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
+				assert(fds[p] > 0);
 			}
 
-			//the last run - deal with all remaining content in buffers
-			while(true){
-				int i = --atomic_partition_number;
-				if(i >= 0){
-					std::string file_name_str = (input + "." + std::to_string(i));
-					global_buffer<T>* g_buf = buffer_manager<T>::get_global_buffer(buffers_for_shuffle, numPartitions, i);
-					g_buf->flush_end(file_name_str, i);
+			run_parallel(num_chunks, [&](int c) {
+				long length = std::min(chunk_size, file_size - c * chunk_size);
+				std::vector<T> edges(length / sizeof(T));
+				io_manager::read_from_file(fd, (char*)edges.data(), length, c * chunk_size);
 
-					delete g_buf;
+				std::vector<int> index(edges.size());
+				std::vector<long> begin(numPartitions + 1, 0);
+				for(size_t i = 0; i < edges.size(); i++) {
+					index[i] = router.get_index(edges[i].src);
+					begin[index[i] + 1]++;
 				}
-				else{
-					break;
-				}
-			}
-		}
-
-		int get_index_partition_vertices(int src) {
+				for(int p = 0; p < numPartitions; p++)
+					begin[p + 1] += begin[p];
 
-			int partition_id = src/ vertices_per_partition;
-			return partition_id < (numPartitions - 1) ? partition_id : (numPartitions - 1);
-		}
+				std::vector<T> grouped(edges.size());
+				std::vector<long> pos(begin.begin(), begin.end() - 1);
+				for(size_t i = 0; i < edges.size(); i++)
+					grouped[pos[index[i]]++] = edges[i];
 
-		int get_index_partition_edges(int src) {
-			for(unsigned int i = 0; i < intervals.size(); i++) {
-				std::pair<VertexId, VertexId> interval = intervals.at(i);
-				if(src >= interval.first && src <= interval.second)
-					return i;
-			}
+				const long * offset = counts.data() + (long)c * numPartitions;
+				for(int p = 0; p < numPartitions; p++)
+					io_manager::write_to_file(fds[p], (char*)(grouped.data() + begin[p]), (begin[p + 1] - begin[p]) * sizeof(T), offset[p]);
+			});
 
-			return -1;
+			for(int p = 0; p < numPartitions; p++)
+				close(fds[p]);
+			close(fd);
 		}
 
 	};
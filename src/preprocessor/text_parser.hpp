@@ -0,0 +1,133 @@
+/*
+ * text_parser.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ */
+
+#ifndef PREPROCESSOR_TEXT_PARSER_HPP_
+#define PREPROCESSOR_TEXT_PARSER_HPP_
+
+#include "../common/RStreamCommon.hpp"
+#include "../core/io_manager.hpp"
+#include "../struct/type.hpp"
+
+#include <sys/mman.h>
+
+namespace RStream {
+
+	// a text input mapped read-only, cut into chunks of whole lines that tasks parse independently
+	class mapped_text {
+		int fd;
+		char * text;
+		long text_size;
+
+	public:
+		mapped_text(const std::string & file_name) : text(nullptr) {
+			fd = open(file_name.c_str(), O_RDONLY);
+			assert(fd > 0);
+			text_size = io_manager::get_filesize(fd);
+
+			if(text_size > 0) {
+				void * addr = mmap(nullptr, text_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				assert(addr != MAP_FAILED);
+				madvise(addr, text_size, MADV_SEQUENTIAL);
+				text = (char*)addr;
+			}
+		}
+
+		~mapped_text() {
+			if(text)
+				munmap(text, text_size);
+			close(fd);
+		}
+
+		inline const char * data() const {
+			return text;
+		}
+
+		inline long size() const {
+			return text_size;
+		}
+
+		// boundaries of chunks of about chunk_size bytes, chunk i is [bounds[i], bounds[i + 1]) and ends after a newline
+		std::vector<long> split_lines(long chunk_size) const {
+			std::vector<long> bounds(1, 0);
+			while(bounds.back() < text_size) {
+				long end = std::min(bounds.back() + chunk_size, text_size);
+				if(end < text_size) {
+					const char * eol = (const char*)std::memchr(text + end - 1, '\n', text_size - end + 1);
+					end = eol ? eol - text + 1 : text_size;
+				}
+				bounds.push_back(end);
+			}
+			return bounds;
+		}
+
+	private:
+		mapped_text(const mapped_text &) = delete;
+		mapped_text & operator=(const mapped_text &) = delete;
+	};
+
+	// fields of one line of text, separated by spaces, tabs or commas. a trailing '\r' counts as a separator,
+	// and nothing is ever read past the end of the line, so lines can be parsed in place in a mapping.
+	class text_parser {
+	public:
+		static inline const char * get_line_end(const char * p, const char * end) {
+			const char * eol = (const char*)std::memchr(p, '\n', end - p);
+			return eol ? eol : end;
+		}
+
+		static inline bool is_comment(const char * p, const char * eol) {
+			return p != eol && (*p == '#' || *p == '%');
+		}
+
+		// skips separators, true if a field follows on the line
+		static inline bool next_field(const char * & p, const char * eol) {
+			while(p != eol && is_separator(*p))
+				p++;
+			return p != eol;
+		}
+
+		// an integer field, p ends up after it
+		static inline VertexId parse_vertex(const char * & p, const char * eol) {
+			bool has_field = next_field(p, eol);
+			assert(has_field);
+			bool negative = *p == '-';
+			if(negative || *p == '+')
+				p++;
+
+			const char * digits = p;
+			VertexId value = 0;
+			while(p != eol && *p >= '0' && *p <= '9')
+				value = value * 10 + (*p++ - '0');
+			assert(p != digits);
+			return negative ? -value : value;
+		}
+
+		// a vertex label, an integer field below 256
+		static inline BYTE parse_label(const char * & p, const char * eol) {
+			return (BYTE)parse_vertex(p, eol);
+		}
+
+		// a decimal field, p ends up after it
+		static inline Weight parse_weight(const char * & p, const char * eol) {
+			bool has_field = next_field(p, eol);
+			assert(has_field);
+			char field[64];
+			int length = 0;
+			while(p != eol && !is_separator(*p) && length < 63)
+				field[length++] = *p++;
+			field[length] = '\0';
+			return strtof(field, nullptr);
+		}
+
+	private:
+		static inline bool is_separator(char c) {
+			return c == ' ' || c == '\t' || c == ',' || c == '\r';
+		}
+	};
+
+}
+
+#endif /* PREPROCESSOR_TEXT_PARSER_HPP_ */
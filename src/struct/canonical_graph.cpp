@@ -22,6 +22,12 @@ namespace RStream {
 		construct_cg(ag, is_directed);
 	}
 
+	Canonical_Graph::Canonical_Graph(std::vector<bliss::Graph::Vertex>& vertices, unsigned int hash){
+		number_of_vertices = vertices.size();
+		hash_value = hash;
+		transform_to_tuple(vertices);
+	}
+
 	Canonical_Graph::~Canonical_Graph(){
 
 	}
@@ -74,12 +80,14 @@ namespace RStream {
 
 	void Canonical_Graph::transform_to_tuple(bliss::AbstractGraph* ag){
 		bliss::Graph* graph = (bliss::Graph*) ag;
+		transform_to_tuple(graph->get_vertices_rstream());
+	}
+
+	void Canonical_Graph::transform_to_tuple(std::vector<bliss::Graph::Vertex>& vertices){
 		std::unordered_set<VertexId> set;
 		std::unordered_map<VertexId, BYTE> map;
 		std::priority_queue<Edge, std::vector<Edge>, EdgeComparator> min_heap;
 
-		std::vector<bliss::Graph::Vertex> vertices = graph->get_vertices_rstream();
-
 		VertexId first_src = init_heapAndset(vertices, min_heap, set);
 		assert(first_src != -1);
 		push_first_element(first_src, map, vertices);
@@ -27,6 +27,9 @@ public:
 
 	Canonical_Graph(bliss::AbstractGraph* ag, bool is_directed);
 
+	// from an undirected graph already in canonical form, with sorted adjacency lists
+	Canonical_Graph(std::vector<bliss::Graph::Vertex>& vertices, unsigned int hash);
+
 	~Canonical_Graph();
 
 
@@ -72,6 +75,8 @@ private:
 
 	void transform_to_tuple(bliss::AbstractGraph* ag);
 
+	void transform_to_tuple(std::vector<bliss::Graph::Vertex>& vertices);
+
 
 	VertexId init_heapAndset(std::vector<bliss::Graph::Vertex>& vertices, std::priority_queue<Edge, std::vector<Edge>, EdgeComparator>& min_heap, std::unordered_set<VertexId>& set);
 
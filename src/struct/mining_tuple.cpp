@@ -23,10 +23,6 @@ void MTuple::init(char* update_local_buf){
 	elements = (Element_In_Tuple*)update_local_buf;
 }
 
-Element_In_Tuple& MTuple::at(unsigned int index){
-	return elements[index];
-}
-
 std::ostream & operator<<(std::ostream & strm, const MTuple& tuple){
 	if(tuple.get_size() == 0){
 		strm << "(empty)";
@@ -54,9 +50,7 @@ MTuple_join::~MTuple_join(){
 
 }
 
-void MTuple_join::init(char * update_local_buf, std::unordered_set<VertexId>& vertices_set){
-	vertices_set.reserve(size);
-
+void MTuple_join::init(char * update_local_buf, Vertex_Set& vertices_set){
 	for(unsigned int index = 0; index < size; index++) {
 		Element_In_Tuple* element = (Element_In_Tuple*)(update_local_buf + index * sizeof(Element_In_Tuple));
 		vertices_set.insert(element->vertex_id);
@@ -65,13 +59,6 @@ void MTuple_join::init(char * update_local_buf, std::unordered_set<VertexId>& ve
 	elements = (Element_In_Tuple*)update_local_buf;
 }
 
-Element_In_Tuple& MTuple_join::at(unsigned int index){
-	if(index == capacity - 1){
-		return *added_element;
-	}
-	return elements[index];
-}
-
 void MTuple_join::push(Element_In_Tuple* element){
 	added_element = element;
 	size++;
@@ -98,10 +85,6 @@ void MTuple_simple::init(char* update_local_buf){
 	elements = (Base_Element*)update_local_buf;
 }
 
-Base_Element& MTuple_simple::at(unsigned int index){
-	return elements[index];
-}
-
 bool MTuple_simple::operator==(const MTuple_simple& other) const{
 	assert(size == other.size);
 	for(unsigned int i = 0; i < size; ++i){
@@ -139,13 +122,6 @@ MTuple_join_simple::~MTuple_join_simple(){
 
 }
 
-Base_Element& MTuple_join_simple::at(unsigned int index){
-	if(index == capacity - 1){
-		return *added_element;
-	}
-	return elements[index];
-}
-
 
 void MTuple_join_simple::push(Base_Element* element){
 	added_element = element;
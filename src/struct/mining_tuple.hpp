@@ -12,17 +12,64 @@
 
 namespace RStream{
 
+// set of the distinct vertices of a tuple. a tuple only has a handful of vertices,
+// so a linear scan over an inline array beats hashing and never allocates
+class Vertex_Set{
+
+public:
+	Vertex_Set() : size(0) {}
+
+	inline bool contains(VertexId id) const{
+		for(unsigned int i = 0; i < size; ++i){
+			if(vertices[i] == id)
+				return true;
+		}
+		return false;
+	}
+
+	// returns false if the vertex is in the set already
+	inline bool insert(VertexId id){
+		if(contains(id))
+			return false;
+		assert(size < MAX_TUPLE_SIZE);
+		vertices[size++] = id;
+		return true;
+	}
+
+	inline unsigned int get_size() const{
+		return size;
+	}
+
+	// position of the vertex in insertion order, -1 if absent
+	inline int index_of(VertexId id) const{
+		for(unsigned int i = 0; i < size; ++i){
+			if(vertices[i] == id)
+				return i;
+		}
+		return -1;
+	}
+
+private:
+	unsigned int size;
+	VertexId vertices[MAX_TUPLE_SIZE];
+
+};
+
+// tuples are views over the stream buffers and are never used polymorphically:
+// at() is resolved statically so it can be inlined in the join and aggregation loops
 class MTuple{
 
 	friend std::ostream & operator<<(std::ostream & strm, const MTuple& cg);
 
 public:
 	MTuple(unsigned int size_of_tuple);
-	virtual ~MTuple();
+	~MTuple();
 
 	void init(char * update_local_buf);
 
-	virtual Element_In_Tuple& at(unsigned int index);
+	inline Element_In_Tuple& at(unsigned int index){
+		return elements[index];
+	}
 
 	inline unsigned int get_size() const{
 		return size;
@@ -32,10 +79,24 @@ public:
 		return elements;
 	}
 
-	inline virtual unsigned int get_num_vertices(){
+	inline unsigned int get_num_vertices(){
 		return elements[size - 1].key_index;
 	}
 
+	inline unsigned int get_pattern_id(){
+		unsigned int id = 0;
+		for(unsigned int i = 0; i < get_pattern_id_bytes(size); ++i){
+			id |= (unsigned int)elements[i].edge_label << (8 * i);
+		}
+		return id;
+	}
+
+	inline void set_pattern_id(unsigned int id){
+		for(unsigned int i = 0; i < get_pattern_id_bytes(size); ++i){
+			elements[i].edge_label = (BYTE)(id >> (8 * i));
+		}
+	}
+
 protected:
 	unsigned int size;
 	Element_In_Tuple* elements;
@@ -48,11 +109,16 @@ class MTuple_join : public MTuple {
 
 public:
 	MTuple_join(unsigned int size_of_tuple);
-	virtual ~MTuple_join();
+	~MTuple_join();
 
-	void init(char * update_local_buf, std::unordered_set<VertexId>& vertices_set);
+	void init(char * update_local_buf, Vertex_Set& vertices_set);
 
-	Element_In_Tuple& at(unsigned int index);
+	inline Element_In_Tuple& at(unsigned int index){
+		if(index == capacity - 1){
+			return *added_element;
+		}
+		return elements[index];
+	}
 
 	void push(Element_In_Tuple* element);
 
@@ -70,6 +136,21 @@ public:
 		return added_element->key_index;
 	}
 
+	// the id bytes may run into the added element
+	inline unsigned int get_pattern_id(){
+		unsigned int id = 0;
+		for(unsigned int i = 0; i < get_pattern_id_bytes(size); ++i){
+			id |= (unsigned int)at(i).edge_label << (8 * i);
+		}
+		return id;
+	}
+
+	inline void set_pattern_id(unsigned int id){
+		for(unsigned int i = 0; i < get_pattern_id_bytes(size); ++i){
+			at(i).edge_label = (BYTE)(id >> (8 * i));
+		}
+	}
+
 
 protected:
 	unsigned int capacity;
@@ -83,16 +164,18 @@ class MTuple_simple {
 	friend std::ostream & operator<<(std::ostream & strm, const MTuple_simple& cg);
 public:
 	MTuple_simple(unsigned int size_of_tuple);
-	virtual ~MTuple_simple();
+	~MTuple_simple();
 
 
 	void init(char * update_local_buf);
 
-	virtual Base_Element& at(unsigned int index);
+	inline Base_Element& at(unsigned int index){
+		return elements[index];
+	}
 
 	bool operator==(const MTuple_simple& other) const;
 
-	virtual inline unsigned int get_hash() const {
+	inline unsigned int get_hash() const {
 		bliss::UintSeqHash h;
 
 		for(unsigned int i = 0; i < size; ++i){
@@ -122,10 +205,15 @@ class MTuple_join_simple : public MTuple_simple {
 	friend std::ostream & operator<<(std::ostream & strm, const MTuple_join_simple& cg);
 public:
 	MTuple_join_simple(unsigned int size_of_tuple);
-	virtual ~MTuple_join_simple();
+	~MTuple_join_simple();
 
 
-	Base_Element& at(unsigned int index);
+	inline Base_Element& at(unsigned int index){
+		if(index == capacity - 1){
+			return *added_element;
+		}
+		return elements[index];
+	}
 
 	void push(Base_Element* element);
 
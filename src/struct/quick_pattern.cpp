@@ -12,11 +12,23 @@ namespace RStream {
 
 	Quick_Pattern::Quick_Pattern(unsigned int size_of_tuple){
 		size = size_of_tuple / sizeof(Element_In_Tuple);
-		elements = new Element_In_Tuple[size];
+		assert(size <= MAX_SIZE);
+	}
+
+	// only the used elements are copied
+	Quick_Pattern::Quick_Pattern(const Quick_Pattern& other){
+		size = other.size;
+		std::copy(other.elements, other.elements + size, elements);
+	}
+
+	Quick_Pattern& Quick_Pattern::operator=(const Quick_Pattern& other){
+		size = other.size;
+		std::copy(other.elements, other.elements + size, elements);
+		return *this;
 	}
 
 	Quick_Pattern::~Quick_Pattern(){
-//		delete[] elements;
+
 	}
 
 	//operator for map
@@ -53,10 +65,6 @@ namespace RStream {
 		return h.get_value();
 	}
 
-	Element_In_Tuple& Quick_Pattern::at(unsigned int index) const {
-		return elements[index];
-	}
-
 
 
 
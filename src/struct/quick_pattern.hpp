@@ -17,8 +17,15 @@ class Quick_Pattern {
 	friend std::ostream & operator<<(std::ostream & strm, const Quick_Pattern& quick_pattern);
 
 public:
+	// elements are stored inline, so a pattern never touches the heap
+	static const unsigned int MAX_SIZE = MAX_TUPLE_SIZE;
+
 	Quick_Pattern(unsigned int size_of_tuple);
 
+	Quick_Pattern(const Quick_Pattern& other);
+
+	Quick_Pattern& operator=(const Quick_Pattern& other);
+
 //	Quick_Pattern(std::vector<Element_In_Tuple>& t){
 //		tuple = t;
 //	}
@@ -31,7 +38,13 @@ public:
 	unsigned int get_hash() const;
 
 
-	Element_In_Tuple& at(unsigned int index) const;
+	inline Element_In_Tuple& at(unsigned int index) {
+		return elements[index];
+	}
+
+	inline const Element_In_Tuple& at(unsigned int index) const {
+		return elements[index];
+	}
 
 //	inline void push(Element_In_Tuple& element){
 //		tuple.push_back(element);
@@ -49,14 +62,10 @@ public:
 		return elements;
 	}
 
-	inline void clean(){
-		delete[] elements;
-	}
-
 private:
 //	std::vector<Element_In_Tuple> tuple;
 	unsigned int size;
-	Element_In_Tuple* elements;
+	Element_In_Tuple elements[MAX_SIZE];
 
 };
 
@@ -31,6 +31,18 @@ enum class FORMAT {
 	AdjList
 };
 
+// how the preprocessor cuts vertex ids into partitions: equal id ranges, or ranges of about equal out-degree sums
+enum class PartitionType {
+	OnVertices,
+	OnEdges
+};
+
+// optional relabeling of the vertices before partitioning: keep the input ids, or number them by decreasing degree
+enum class VertexOrder {
+	Original,
+	DegreeSorted
+};
+
 enum class EdgeType {
 	NO_WEIGHT = 0,
 	WITH_WEIGHT = 1,
@@ -159,11 +171,21 @@ inline std::ostream & operator<<(std::ostream & strm, const BaseUpdate& up){
 }
 
 
+// upper bound on the number of elements in a mining tuple
+const unsigned int MAX_TUPLE_SIZE = 16;
+
+// number of elements of a tuple whose edge label bytes hold its pattern id
+inline unsigned int get_pattern_id_bytes(unsigned int tuple_size){
+	return tuple_size < sizeof(unsigned int) ? tuple_size : sizeof(unsigned int);
+}
+
 /*
  *  Graph mining support. Join on all keys for each vertex tuple.
  *  Each element in the tuple contains 8 bytes, first 4 bytes is vertex id,
  *  second 4 bytes contains edge label(1byte) + vertex label(1byte) + history info(1byte).
  *  History info is used to record subgraph structure.
+ *  Edges are not labeled in mining, so the edge label bytes of the first elements of a tuple
+ *  hold the id of its quick pattern instead, low byte first (see get_pattern_id_bytes).
  *
  *
  *  [ ] [ ] [ ] [ ] || [ ] [ ] [ ] [ ]
@@ -0,0 +1,128 @@
+/*
+ * intersection_bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ *
+ *  Microbenchmark of the intersection kernels over pairs of sorted ranges with skewed length ratios.
+ *  Every kernel is checked against the scalar merge first. The kernels need distinct ids, so an edge_index
+ *  built over parallel edges is checked to keep them all, and its ranges are intersected once deduplicated.
+ *
+ *  g++ -std=c++0x -O3 -Ilib/bliss-0.73/ -o bin/intersection_bench src/test/intersection_bench.cpp src/core/intersection.cpp \
+ *      src/core/edge_index.cpp -lpthread
+ *  bin/intersection_bench [length of the longer range] [repetitions]
+ */
+
+#include "../core/intersection.hpp"
+#include "../core/edge_index.hpp"
+
+#include <chrono>
+#include <random>
+
+using namespace RStream;
+
+// sorted distinct ids drawn from [0, universe)
+static std::vector<VertexId> gen_range(long size, long universe, std::mt19937 & gen) {
+	std::uniform_int_distribution<VertexId> dist(0, universe - 1);
+	std::unordered_set<VertexId> ids;
+	while((long)ids.size() < size)
+		ids.insert(dist(gen));
+	std::vector<VertexId> range(ids.begin(), ids.end());
+	std::sort(range.begin(), range.end());
+	return range;
+}
+
+static double time_ns(std::function<long()> work, int repetitions, long & result) {
+	auto start = std::chrono::high_resolution_clock::now();
+	for(int r = 0; r < repetitions; r++)
+		result = work();
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / repetitions;
+}
+
+// two partitions whose edges repeat targets, in and out of order, and come with repeats in both neighbor ranges
+static void check_repeated_ids(const std::vector<intersection_kernel> & kernels) {
+	const std::string filename = "intersection_bench.el";
+	const std::vector<std::pair<VertexId, VertexId>> vertex_intervals = {{0, 1}, {2, 3}};
+	const std::vector<std::vector<Edge>> partitions = {
+		{Edge(0, 5), Edge(0, 3), Edge(0, 5), Edge(0, 9), Edge(0, 3), Edge(0, 3), Edge(1, 2), Edge(0, 7), Edge(0, 9)},
+		{Edge(2, 3), Edge(2, 3), Edge(2, 9), Edge(2, 5), Edge(2, 5), Edge(2, 5), Edge(2, 8), Edge(3, 0), Edge(2, 9)}
+	};
+	for(unsigned int p = 0; p < partitions.size(); p++) {
+		std::ofstream file(filename + "." + std::to_string(p), std::ios::binary);
+		file.write((const char*)partitions[p].data(), partitions[p].size() * sizeof(Edge));
+	}
+
+	// every parallel edge stays in the index, as in the partitions, with the ranges sorted
+	edge_index index;
+	index.load(filename, vertex_intervals, sizeof(Edge), 2);
+	assert(index.get_num_edges() == 18 && index.has_parallel_edges());
+	for(VertexId v = 0; v <= vertex_intervals.back().second; v++)
+		assert(std::is_sorted(index.get_neighbors(v), index.get_neighbors(v) + index.get_degree(v)));
+
+	// so the ranges are deduplicated before intersecting, as the clique join does. {3, 5, 7, 9} ^ {3, 5, 8, 9}
+	std::vector<VertexId> a, b;
+	std::unique_copy(index.get_neighbors(0), index.get_neighbors(0) + index.get_degree(0), std::back_inserter(a));
+	std::unique_copy(index.get_neighbors(2), index.get_neighbors(2) + index.get_degree(2), std::back_inserter(b));
+	assert(a.size() == 4 && b.size() == 4);
+	const VertexId expected[] = {3, 5, 9};
+	std::vector<VertexId> out(a.size());
+	for(auto & k : kernels) {
+		assert(k.count(a.data(), a.size(), b.data(), b.size()) == 3);
+		long n = k.intersect(a.data(), a.size(), b.data(), b.size(), out.data());
+		assert(n == 3 && std::equal(out.begin(), out.begin() + n, expected));
+	}
+
+	for(unsigned int p = 0; p < partitions.size(); p++)
+		std::remove((filename + "." + std::to_string(p)).c_str());
+	std::remove(edge_index::get_file_name(filename).c_str());
+	std::cout << "repeated ids: parallel edges kept in the index, every kernel agrees on the deduplicated ranges" << std::endl;
+}
+
+int main(int argc, char **argv) {
+	long size_long = argc > 1 ? atol(argv[1]) : 65536;
+	int repetitions = argc > 2 ? atoi(argv[2]) : 200;
+
+	std::mt19937 gen(17);
+	std::vector<intersection_kernel> kernels = intersection::get_supported_kernels();
+	intersection_kernel galloping = {"galloping", &intersection::count_galloping, &intersection::intersect_galloping};
+	kernels.push_back(galloping);
+	check_repeated_ids(kernels);
+
+	std::cout << "dispatch kernel: " << intersection::get_kernel().name << ", galloping from ratio " << intersection::GALLOPING_RATIO << std::endl;
+	std::cout << std::setw(8) << "ratio" << std::setw(10) << "|a|" << std::setw(10) << "|a^b|" << std::setw(12) << "kernel"
+			<< std::setw(14) << "count ns" << std::setw(14) << "intersect ns" << std::endl;
+
+	const long ratios[] = {1, 2, 4, 16, 64, 256, 1024};
+	for(long ratio : ratios) {
+		long size_short = std::max(1L, size_long / ratio);
+		// the universe keeps about a quarter of the short range in common
+		std::vector<VertexId> b = gen_range(size_long, size_long * 4, gen);
+		std::vector<VertexId> a = gen_range(size_short, size_long * 4, gen);
+		std::vector<VertexId> expected(size_short), out(size_short);
+		long n_expected = intersection::intersect_scalar(a.data(), size_short, b.data(), size_long, expected.data());
+
+		std::vector<std::pair<const char *, std::pair<count_function, intersect_function>>> runs;
+		for(auto & k : kernels)
+			runs.push_back(std::make_pair(k.name, std::make_pair(k.count, k.intersect)));
+		runs.push_back(std::make_pair("dispatch", std::make_pair(&intersection::count, &intersection::intersect)));
+
+		for(auto & run : runs) {
+			count_function count = run.second.first;
+			intersect_function intersect = run.second.second;
+
+			long n = 0;
+			double ns_count = time_ns([&] { return count(a.data(), size_short, b.data(), size_long); }, repetitions, n);
+			assert(n == n_expected);
+			double ns_intersect = time_ns([&] { return intersect(a.data(), size_short, b.data(), size_long, out.data()); }, repetitions, n);
+			assert(n == n_expected && std::equal(out.begin(), out.begin() + n, expected.begin()));
+			// operands swapped
+			assert(count(b.data(), size_long, a.data(), size_short) == n_expected);
+
+			std::cout << std::setw(8) << ratio << std::setw(10) << size_short << std::setw(10) << n_expected << std::setw(12) << run.first
+					<< std::setw(14) << std::fixed << std::setprecision(0) << ns_count << std::setw(14) << ns_intersect << std::endl;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * reorder_bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: kai
+ *
+ *  Cache misses and time of an RPhase hash join with the input vertex order and with the vertices
+ *  relabeled by decreasing degree. Every edge (u, v) is joined with the out-edges of v; the join keeps
+ *  nothing, so the probes into edge_hashmap are all that is measured. Both orders must find the same
+ *  number of 2-paths. Partitions are edge balanced in both runs, as degree order packs the hubs into
+ *  the first vertex range. Misses come from perf_event_open and are reported n/a where it is not permitted.
+ *
+ *  make && g++ -std=c++0x -O3 -Ilib/bliss-0.73/ -Llib/bliss-0.73/ -o bin/reorder_bench src/test/reorder_bench.cpp \
+ *      src/core/*.o src/struct/*.o src/utility/*.o -lbliss -lpthread
+ *  bin/reorder_bench [input graph(edge list format)] [num of partitions]
+ */
+
+#include "../core/engine.hpp"
+#include "../core/scatter.hpp"
+#include "../core/relation_phase.hpp"
+#include "../core/global_info.hpp"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+
+using namespace RStream;
+
+struct RInUpdate_Path : BaseUpdate {
+	VertexId src;
+
+	RInUpdate_Path() : BaseUpdate () {}
+	RInUpdate_Path(VertexId t, VertexId s) : BaseUpdate(t), src(s) {}
+};
+
+void generate_one_update(Edge * e, RInUpdate_Path & update) {
+	update.target = e->target;
+	update.src = e->src;
+}
+
+// counts the 2-paths u -> v -> w, w != u, and drops them
+class Path_Count : public RPhase<RInUpdate_Path, RInUpdate_Path> {
+public:
+	std::atomic<long> num_paths;
+
+	Path_Count(Engine & e) : RPhase(e), num_paths(0) {};
+	~Path_Count(){};
+
+	bool filter(RInUpdate_Path * update, VertexId edge_src, VertexId edge_dst) {
+		if(update->src != edge_dst)
+			num_paths.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	void project_columns(RInUpdate_Path * in_update, VertexId edge_src, VertexId edge_dst, RInUpdate_Path & new_update) {
+		new_update = *in_update;
+	}
+};
+
+// a hardware counter of this process and the threads it starts, -1 if not available
+static int open_counter(unsigned int type, unsigned long long config) {
+	struct perf_event_attr attr;
+	std::memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.inherit = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static long read_counter(int fd) {
+	long long value = 0;
+	if(fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value))
+		return -1;
+	return value;
+}
+
+static void run(const std::string & input, int num_partitions, VertexOrder order, const char * name, std::ostream & row) {
+	// every order preprocesses its own copy of the input
+	std::string file_name = input + "." + name;
+	std::ifstream src(input, std::ios::binary);
+	std::ofstream dst(file_name, std::ios::binary);
+	dst << src.rdbuf();
+	dst.close();
+
+	Engine e(file_name, num_partitions, (int)FORMAT::EdgeList, PartitionType::OnEdges, order);
+	Scatter<BaseVertex, RInUpdate_Path> scatter_phase(e);
+	Update_Stream in_stream = scatter_phase.scatter_no_vertex(generate_one_update);
+
+	int fd_misses = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+	int fd_references = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES);
+	for(int fd : {fd_misses, fd_references}) {
+		if(fd >= 0)
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+
+	Path_Count join(e);
+	auto start = std::chrono::high_resolution_clock::now();
+	Update_Stream out_stream = join.join(in_stream);
+	auto end = std::chrono::high_resolution_clock::now();
+
+	for(int fd : {fd_misses, fd_references}) {
+		if(fd >= 0)
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+	}
+	long misses = read_counter(fd_misses), references = read_counter(fd_references);
+
+	row << std::setw(14) << name << std::setw(16) << join.num_paths << std::setw(12) << std::fixed << std::setprecision(3)
+			<< std::chrono::duration<double>(end - start).count();
+	if(misses < 0 || references <= 0)
+		row << std::setw(16) << "n/a" << std::setw(12) << "n/a" << std::endl;
+	else
+		row << std::setw(16) << misses << std::setw(11) << std::setprecision(1) << 100.0 * misses / references << "%" << std::endl;
+
+	for(int fd : {fd_misses, fd_references}) {
+		if(fd >= 0)
+			close(fd);
+	}
+	Global_Info::delete_upstream(in_stream, e);
+	Global_Info::delete_upstream(out_stream, e);
+	e.clean_files();
+	FileUtil::delete_file(file_name);
+}
+
+int main(int argc, char **argv) {
+	if(argc != 3) {
+		fprintf(stderr, "usage: bin/reorder_bench [input graph(edge list format)] [num of partitions]\n");
+		exit(-1);
+	}
+
+	// rows are printed once the engines are done logging
+	std::stringstream rows;
+	run(std::string(argv[1]), atoi(argv[2]), VertexOrder::Original, "original", rows);
+	run(std::string(argv[1]), atoi(argv[2]), VertexOrder::DegreeSorted, "degree_sorted", rows);
+
+	std::cout << "\n" << std::setw(14) << "order" << std::setw(16) << "2-paths" << std::setw(12) << "join s"
+			<< std::setw(16) << "cache misses" << std::setw(12) << "miss rate" << std::endl;
+	std::cout << rows.str();
+
+	return 0;
+}